@@ -0,0 +1,480 @@
+// Throughput benchmark for sJSON. Every corpus is generated from a fixed seed, so runs on different
+// machines and versions measure the same bytes. Results are printed as one JSON document.
+//
+//     make -C benchmark run
+//     ./benchmark/sJsonBenchmark --min-time 1 --scale 4 --filter numbers
+//     ./benchmark/sJsonBenchmark --write-corpora /tmp/corpora
+
+#include "../sJson.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// Every allocation of the process goes through these counters, so each result can report how many
+// allocations one operation made and how much heap it held at its peak.
+struct AllocationCounters {
+    std::atomic<size_t> Count{0};
+    std::atomic<size_t> Bytes{0};
+    std::atomic<size_t> Live{0};
+    std::atomic<size_t> Peak{0};
+};
+
+static AllocationCounters Counters;
+
+static void *CountedAllocate(size_t Size, size_t Align) {
+    // The size and header width are kept just before the block handed out.
+    size_t Header = Align < 2 * sizeof(size_t) ? 2 * sizeof(size_t) : Align;
+    size_t Total = (Header + Size + Header - 1) / Header * Header;
+    auto Block = static_cast<char *>(std::aligned_alloc(Header, Total));
+    if (Block == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    auto Result = Block + Header;
+    reinterpret_cast<size_t *>(Result)[-1] = Size;
+    reinterpret_cast<size_t *>(Result)[-2] = Header;
+
+    Counters.Count.fetch_add(1, std::memory_order_relaxed);
+    Counters.Bytes.fetch_add(Size, std::memory_order_relaxed);
+    size_t Live = Counters.Live.fetch_add(Size, std::memory_order_relaxed) + Size;
+    size_t Peak = Counters.Peak.load(std::memory_order_relaxed);
+    while (Live > Peak && !Counters.Peak.compare_exchange_weak(Peak, Live, std::memory_order_relaxed)) {
+    }
+
+    return Result;
+}
+
+static void CountedFree(void *Pointer) {
+    if (Pointer == nullptr) {
+        return;
+    }
+
+    auto Result = static_cast<char *>(Pointer);
+    Counters.Live.fetch_sub(reinterpret_cast<size_t *>(Result)[-1], std::memory_order_relaxed);
+    std::free(Result - reinterpret_cast<size_t *>(Result)[-2]);
+}
+
+void *operator new(size_t Size) {
+    return CountedAllocate(Size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t Size, std::align_val_t Align) {
+    return CountedAllocate(Size, static_cast<size_t>(Align));
+}
+
+void operator delete(void *Pointer) noexcept {
+    CountedFree(Pointer);
+}
+
+void operator delete(void *Pointer, size_t) noexcept {
+    CountedFree(Pointer);
+}
+
+void operator delete(void *Pointer, std::align_val_t) noexcept {
+    CountedFree(Pointer);
+}
+
+void operator delete(void *Pointer, size_t, std::align_val_t) noexcept {
+    CountedFree(Pointer);
+}
+
+// SplitMix64: fixed output for a given seed on every platform, unlike the std distributions.
+class CorpusRandom {
+public:
+    explicit CorpusRandom(uint64_t Seed) : State(Seed) {
+    }
+
+public:
+    uint64_t Next() {
+        uint64_t Value = (State += 0x9E3779B97F4A7C15ULL);
+        Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+        return Value ^ (Value >> 31);
+    }
+
+    size_t Below(size_t Limit) {
+        return static_cast<size_t>(Next() % Limit);
+    }
+
+private:
+    uint64_t State;
+};
+
+struct Corpus {
+    std::string Name;
+    std::string Text;
+    bool Lines;
+};
+
+static void AppendNumber(std::string &Output, CorpusRandom &Random) {
+    char Buffer[32];
+    switch (Random.Below(4)) {
+        case 0: {
+            snprintf(Buffer, sizeof(Buffer), "%d", static_cast<int>(Random.Below(2000001)) - 1000000);
+            break;
+        }
+        case 1: {
+            snprintf(Buffer, sizeof(Buffer), "%lld", static_cast<long long>(Random.Next() >> 2) - (1LL << 61));
+            break;
+        }
+        case 2: {
+            snprintf(Buffer, sizeof(Buffer), "%.17g", static_cast<double>(Random.Next() >> 11) / (1ULL << 40));
+            break;
+        }
+        default: {
+            snprintf(Buffer, sizeof(Buffer), "%.6e", (static_cast<double>(Random.Below(1000000)) - 500000.0) * 1e-7);
+            break;
+        }
+    }
+    Output += Buffer;
+}
+
+static void AppendText(std::string &Output, CorpusRandom &Random, size_t Length, bool Escapes) {
+    static const char *Words[] = {"alpha", "beta", "gamma", "delta", "json", "parser", "\xC3\xA9t\xC3\xA9",
+                                  "\xE6\x95\xB0\xE6\x8D\xAE", "value", "token"};
+    static const char *EscapeSequences[] = {"\\\"", "\\\\", "\\n", "\\t", "\\r", "\\/", "\\u00e9"};
+
+    Output += '\"';
+    size_t Begin = Output.size();
+    while (Output.size() - Begin < Length) {
+        if (Escapes && Random.Below(4) == 0) {
+            Output += EscapeSequences[Random.Below(sizeof(EscapeSequences) / sizeof(*EscapeSequences))];
+        } else {
+            Output += Words[Random.Below(sizeof(Words) / sizeof(*Words))];
+            Output += ' ';
+        }
+    }
+    Output += '\"';
+}
+
+// Records with a couple of hundred members each.
+static std::string MakeWideObjects(size_t Scale) {
+    CorpusRandom Random(1);
+    std::string Output = "{\"records\": [";
+    for (size_t Record = 0; Record < 400 * Scale; ++Record) {
+        Output += Record == 0 ? "\n  {" : ",\n  {";
+        for (size_t Field = 0; Field < 200; ++Field) {
+            Output += Field == 0 ? "\"field_" : ", \"field_";
+            Output += std::to_string(Field);
+            Output += "\": ";
+            switch (Random.Below(5)) {
+                case 0: {
+                    AppendText(Output, Random, 12, false);
+                    break;
+                }
+                case 1: {
+                    Output += Random.Below(2) == 0 ? "true" : "false";
+                    break;
+                }
+                case 2: {
+                    Output += "null";
+                    break;
+                }
+                default: {
+                    AppendNumber(Output, Random);
+                    break;
+                }
+            }
+        }
+        Output += '}';
+    }
+    Output += "\n]}\n";
+
+    return Output;
+}
+
+// Chains of objects and arrays nested a few hundred levels deep.
+static std::string MakeDeepNesting(size_t Scale) {
+    CorpusRandom Random(2);
+    std::string Output = "{\"chains\": [";
+    for (size_t Chain = 0; Chain < 200 * Scale; ++Chain) {
+        Output += Chain == 0 ? "\n" : ",\n";
+        size_t Depth = 200 + Random.Below(300);
+        std::string Closers;
+        for (size_t Level = 0; Level < Depth; ++Level) {
+            if (Random.Below(2) == 0) {
+                Output += "{\"level\": " + std::to_string(Level) + ", \"next\": ";
+                Closers += '}';
+            } else {
+                Output += "[" + std::to_string(Level) + ", ";
+                Closers += ']';
+            }
+        }
+        Output += "null";
+        Output.append(Closers.rbegin(), Closers.rend());
+    }
+    Output += "\n]}\n";
+
+    return Output;
+}
+
+// Long arrays of integers, 64-bit integers and doubles.
+static std::string MakeNumbers(size_t Scale) {
+    CorpusRandom Random(3);
+    std::string Output = "{\"series\": [";
+    for (size_t Series = 0; Series < 40 * Scale; ++Series) {
+        Output += Series == 0 ? "\n  [" : ",\n  [";
+        for (size_t Index = 0; Index < 5000; ++Index) {
+            if (Index != 0) {
+                Output += ", ";
+            }
+            AppendNumber(Output, Random);
+        }
+        Output += ']';
+    }
+    Output += "\n]}\n";
+
+    return Output;
+}
+
+// Paragraph-sized strings full of escape sequences and multi-byte UTF-8.
+static std::string MakeStrings(size_t Scale) {
+    CorpusRandom Random(4);
+    std::string Output = "{\"documents\": [";
+    for (size_t Document = 0; Document < 4000 * Scale; ++Document) {
+        Output += Document == 0 ? "\n  {\"title\": " : ",\n  {\"title\": ";
+        AppendText(Output, Random, 40, true);
+        Output += ", \"body\": ";
+        AppendText(Output, Random, 800 + Random.Below(800), true);
+        Output += '}';
+    }
+    Output += "\n]}\n";
+
+    return Output;
+}
+
+// One small record per line, as in logs and event streams.
+static std::string MakeLines(size_t Scale) {
+    CorpusRandom Random(5);
+    std::string Output;
+    for (size_t Line = 0; Line < 40000 * Scale; ++Line) {
+        Output += "{\"id\": " + std::to_string(Line) + ", \"user\": ";
+        AppendText(Output, Random, 10, false);
+        Output += ", \"score\": ";
+        AppendNumber(Output, Random);
+        Output += ", \"tags\": [\"a\", \"b\", \"c\"], \"active\": ";
+        Output += Random.Below(2) == 0 ? "true" : "false";
+        Output += ", \"geo\": {\"lat\": ";
+        AppendNumber(Output, Random);
+        Output += ", \"lon\": ";
+        AppendNumber(Output, Random);
+        Output += "}}\n";
+    }
+
+    return Output;
+}
+
+struct Measurement {
+    size_t Iterations;
+    double Seconds;
+    double BestSeconds;
+    size_t Allocations;
+    size_t AllocatedBytes;
+    size_t PeakBytes;
+};
+
+// Runs Operation once to count its allocations, then repeatedly until MinimumTime has passed.
+template<class Callable>
+static Measurement Measure(double MinimumTime, Callable &&Operation) {
+    Measurement Result{};
+    size_t Count = Counters.Count.load();
+    size_t Bytes = Counters.Bytes.load();
+    size_t Live = Counters.Live.load();
+    Counters.Peak.store(Live);
+    Operation();
+    Result.Allocations = Counters.Count.load() - Count;
+    Result.AllocatedBytes = Counters.Bytes.load() - Bytes;
+    Result.PeakBytes = Counters.Peak.load() - Live;
+
+    Result.BestSeconds = 1e300;
+    auto Begin = std::chrono::steady_clock::now();
+    do {
+        auto Start = std::chrono::steady_clock::now();
+        Operation();
+        double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        Result.BestSeconds = Seconds < Result.BestSeconds ? Seconds : Result.BestSeconds;
+        ++Result.Iterations;
+        Result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+    } while (Result.Seconds < MinimumTime || Result.Iterations < 3);
+
+    return Result;
+}
+
+// Visits every value, looking each member up by key the way application code would.
+static size_t Navigate(sJSONValue *Value) {
+    size_t Visited = 0;
+    std::vector<sJSONValue *> Pending(1, Value);
+    while (!Pending.empty()) {
+        auto Current = Pending.back();
+        Pending.pop_back();
+        ++Visited;
+        if (Current->GetType() == sJSONValueType::Object) {
+            auto &Children = static_cast<sJSONObject *>(Current)->Children;
+            for (auto &Member : Children) {
+                Pending.push_back(Children.Find(Member.first)->Value);
+            }
+        } else if (Current->GetType() == sJSONValueType::Array) {
+            auto &ValueSet = static_cast<sJSONArray *>(Current)->ValueSet;
+            Pending.insert(Pending.end(), ValueSet.begin(), ValueSet.end());
+        }
+    }
+
+    return Visited;
+}
+
+static void Report(bool &First, const Corpus &Source, const char *Operation, size_t Bytes, size_t Documents,
+                   const Measurement &Result) {
+    double Seconds = Result.Seconds / Result.Iterations;
+    printf("%s    {\"corpus\": \"%s\", \"operation\": \"%s\", \"bytes\": %zu, \"documents\": %zu, "
+           "\"iterations\": %zu, \"mean_seconds\": %.9f, \"best_seconds\": %.9f, \"mb_per_second\": %.2f, "
+           "\"documents_per_second\": %.1f, \"allocations\": %zu, \"allocated_bytes\": %zu, \"peak_bytes\": %zu}",
+           First ? "" : ",\n", Source.Name.c_str(), Operation, Bytes, Documents, Result.Iterations, Seconds,
+           Result.BestSeconds, Bytes / Seconds / 1e6, Documents / Seconds, Result.Allocations,
+           Result.AllocatedBytes, Result.PeakBytes);
+    fflush(stdout);
+    First = false;
+}
+
+static void RunDocument(bool &First, const Corpus &Source, double MinimumTime) {
+    sJSONParser Parser(std::string_view(Source.Text), sJSONInputMode::Reference);
+    auto Root = Parser.Parse();
+    if (Parser.GetStatus().ExsitsError()) {
+        fprintf(stderr, "corpus %s does not parse\n", Source.Name.c_str());
+        exit(1);
+    }
+
+    Report(First, Source, "parse", Source.Text.size(), 1, Measure(MinimumTime, [&]() {
+               sJSONParser Instance(Source.Text);
+               Instance.Parse();
+           }));
+    Report(First, Source, "parse_reference", Source.Text.size(), 1, Measure(MinimumTime, [&]() {
+               sJSONParser Instance(std::string_view(Source.Text), sJSONInputMode::Reference);
+               Instance.Parse();
+           }));
+
+    size_t Pretty = sJSONWriter::WriteJSON(Root).size();
+    Report(First, Source, "write_pretty", Pretty, 1, Measure(MinimumTime, [&]() { sJSONWriter::WriteJSON(Root); }));
+    size_t Compact = sJSONWriter::WriteJSON(Root, false).size();
+    Report(First, Source, "write_compact", Compact, 1,
+           Measure(MinimumTime, [&]() { sJSONWriter::WriteJSON(Root, false); }));
+
+    for (bool Format : {true, false}) {
+        Report(First, Source, Format ? "transcode_pretty" : "transcode_compact", Source.Text.size(), 1,
+               Measure(MinimumTime, [&]() {
+                   sJSONStringSink Output;
+                   sJSONTranscoder<sJSONStringSink> Transcoder(Output, Format);
+                   Transcoder.Transcode(Source.Text);
+               }));
+    }
+
+    Report(First, Source, "navigate", Source.Text.size(), 1,
+           Measure(MinimumTime, [&]() { Navigate(Root.GetObject()); }));
+
+    // Hashes are cached after the first run, so this is the member-by-member confirmation of equal trees.
+    sJSONParser CopyParser(std::string_view(Source.Text), sJSONInputMode::Reference);
+    auto Copy = CopyParser.Parse();
+    Report(First, Source, "equal", Source.Text.size(), 1,
+           Measure(MinimumTime, [&]() { sJSONComparer::Equal(Root, Copy); }));
+    Report(First, Source, "freeze", Source.Text.size(), 1,
+           Measure(MinimumTime, [&]() { sJSONFrozenDocument Frozen(Root); }));
+}
+
+static void RunLines(bool &First, const Corpus &Source, double MinimumTime) {
+    std::vector<std::string_view> Lines;
+    std::string_view Text(Source.Text);
+    for (size_t Begin = 0; Begin < Text.size();) {
+        size_t End = Text.find('\n', Begin);
+        End = End == std::string_view::npos ? Text.size() : End;
+        Lines.push_back(Text.substr(Begin, End - Begin));
+        Begin = End + 1;
+    }
+
+    Report(First, Source, "parse", Source.Text.size(), Lines.size(), Measure(MinimumTime, [&]() {
+               for (auto Line : Lines) {
+                   sJSONParser Instance(Line, sJSONInputMode::Reference);
+                   Instance.Parse();
+               }
+           }));
+
+    sJSONBatchParser Batch;
+    Report(First, Source, "batch_parse", Source.Text.size(), Lines.size(),
+           Measure(MinimumTime, [&]() { Batch.Parse(Source.Text, sJSONInputMode::Reference); }));
+}
+
+static void PrintUsage() {
+    fprintf(stderr, "usage: sJsonBenchmark [--min-time SECONDS] [--scale N] [--filter TEXT] "
+                    "[--write-corpora DIRECTORY]\n");
+}
+
+int main(int Count, char **Arguments) {
+    double MinimumTime = 0.5;
+    size_t Scale = 1;
+    std::string Filter;
+    std::string CorpusDirectory;
+    for (int Index = 1; Index < Count; ++Index) {
+        std::string_view Option = Arguments[Index];
+        if (Index + 1 == Count) {
+            PrintUsage();
+            return 1;
+        }
+        if (Option == "--min-time") {
+            MinimumTime = atof(Arguments[++Index]);
+        } else if (Option == "--scale") {
+            Scale = static_cast<size_t>(atoi(Arguments[++Index]));
+            Scale = Scale == 0 ? 1 : Scale;
+        } else if (Option == "--filter") {
+            Filter = Arguments[++Index];
+        } else if (Option == "--write-corpora") {
+            CorpusDirectory = Arguments[++Index];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<Corpus> Corpora = {{"wide_objects", MakeWideObjects(Scale), false},
+                                   {"deep_nesting", MakeDeepNesting(Scale), false},
+                                   {"numbers", MakeNumbers(Scale), false},
+                                   {"strings", MakeStrings(Scale), false},
+                                   {"ndjson", MakeLines(Scale), true}};
+
+    if (!CorpusDirectory.empty()) {
+        for (auto &Source : Corpora) {
+            std::string Path = CorpusDirectory + "/" + Source.Name + (Source.Lines ? ".ndjson" : ".json");
+            FILE *File = fopen(Path.c_str(), "wb");
+            if (File == nullptr || fwrite(Source.Text.data(), 1, Source.Text.size(), File) != Source.Text.size()) {
+                fprintf(stderr, "cannot write %s\n", Path.c_str());
+                return 1;
+            }
+            fclose(File);
+        }
+    }
+
+    printf("{\n  \"benchmark\": \"sJSON\",\n  \"format\": 1,\n  \"compiler\": \"%s\",\n  \"scale\": %zu,\n"
+           "  \"min_time\": %.3f,\n  \"simd\": %d,\n  \"results\": [\n",
+#if defined(__clang__)
+           "clang " __clang_version__,
+#elif defined(__GNUC__)
+           "gcc " __VERSION__,
+#else
+           "unknown",
+#endif
+           Scale, MinimumTime, static_cast<int>(sJSONActiveSIMDLevel));
+
+    bool First = true;
+    for (auto &Source : Corpora) {
+        if (!Filter.empty() && Source.Name.find(Filter) == std::string::npos) {
+            continue;
+        }
+        if (Source.Lines) {
+            RunLines(First, Source, MinimumTime);
+        } else {
+            RunDocument(First, Source, MinimumTime);
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
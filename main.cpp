@@ -22,10 +22,11 @@ int main()
 		auto ObjectExpand = sJSONElementFinder((*Object)->To<sJSONObject *>());
 		for (auto Instance : ObjectExpand)
 		{
-			printf("<%s, ", Instance.first.c_str());
+			printf("<%.*s, ", (int)Instance.first.size(), Instance.first.data());
 			if (sJSONstring::Equal(**Instance.second))
 			{
-				printf("%s> ", (**Instance.second->To<sJSONstring*>()).c_str());
+				auto String = **Instance.second->To<sJSONstring *>();
+				printf("%.*s> ", (int)String.size(), String.data());
 			}
 			if (sJSONInt::Equal(**Instance.second))
 			{
@@ -1,10 +1,67 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <typeinfo>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// __forceinline is an MSVC keyword; other compilers get the equivalent attribute.
+#if !defined(_MSC_VER) && !defined(__forceinline)
+#define __forceinline inline __attribute__((always_inline))
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define sJSON_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define sJSON_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define sJSON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 class sJSONElementNode;
 
 enum class sJSONValueType {
@@ -14,6 +71,11 @@ enum class sJSONValueType {
     Null
 };
 
+enum class sJSONInputMode {
+    Copy,
+    Reference
+};
+
 enum class sJSONTokenType {
     BigLeft,
     BigRight,
@@ -47,6 +109,226 @@ std::map<sJSONTokenType, sJSONTokenType> sJSONOppsiteTokenMap = {
         {sJSONTokenType::BigLeft,    sJSONTokenType::BigRight},
         {sJSONTokenType::MiddleLeft, sJSONTokenType::MiddleRight}};
 
+struct alignas(std::max_align_t) sJSONArenaChunk {
+    sJSONArenaChunk *Next;
+    size_t Size;
+    size_t Used;
+
+    char *Data() {
+        return reinterpret_cast<char *>(this + 1);
+    }
+};
+
+// A chunked bump-pointer allocator. Memory is only given back all at once, either by Reset(),
+// which keeps the chunks around for the next use, or by destroying the arena.
+class sJSONArena {
+public:
+    static constexpr size_t DefaultChunkSize = 64 * 1024;
+    static constexpr size_t MaxChunkSize = 16 * 1024 * 1024;
+
+public:
+    explicit sJSONArena(size_t ChunkSize = DefaultChunkSize)
+            : Head(nullptr), Current(nullptr), ChunkSize(ChunkSize), NextChunkSize(ChunkSize) {
+    }
+
+    sJSONArena(const sJSONArena &) = delete;
+
+    sJSONArena &operator=(const sJSONArena &) = delete;
+
+    sJSONArena(sJSONArena &&Other) noexcept
+            : Head(Other.Head), Current(Other.Current), ChunkSize(Other.ChunkSize),
+              NextChunkSize(Other.NextChunkSize) {
+        Other.Head = nullptr;
+        Other.Current = nullptr;
+        Other.NextChunkSize = Other.ChunkSize;
+    }
+
+    sJSONArena &operator=(sJSONArena &&Other) noexcept {
+        if (this != &Other) {
+            Release();
+            std::swap(Head, Other.Head);
+            std::swap(Current, Other.Current);
+            std::swap(ChunkSize, Other.ChunkSize);
+            std::swap(NextChunkSize, Other.NextChunkSize);
+        }
+
+        return *this;
+    }
+
+    ~sJSONArena() {
+        Release();
+    }
+
+public:
+    __forceinline void *Allocate(size_t Size, size_t Align = alignof(std::max_align_t)) {
+        if (Current != nullptr) {
+            size_t Offset = (Current->Used + Align - 1) & ~(Align - 1);
+            if (Offset + Size <= Current->Size) {
+                Current->Used = Offset + Size;
+                return Current->Data() + Offset;
+            }
+        }
+
+        return AllocateSlow(Size, Align);
+    }
+
+    template<class Type, class... Args>
+    Type *Create(Args &&...Arguments) {
+        return new (Allocate(sizeof(Type), alignof(Type))) Type(std::forward<Args>(Arguments)...);
+    }
+
+    void Reset() {
+        for (auto Chunk = Head; Chunk != nullptr; Chunk = Chunk->Next) {
+            Chunk->Used = 0;
+        }
+        Current = Head;
+    }
+
+    void Release() {
+        while (Head != nullptr) {
+            auto Next = Head->Next;
+            ::operator delete(Head);
+            Head = Next;
+        }
+        Current = nullptr;
+        NextChunkSize = ChunkSize;
+    }
+
+    const size_t GetUsedBytes() const {
+        size_t Bytes = 0;
+        for (auto Chunk = Head; Chunk != nullptr; Chunk = Chunk->Next) {
+            Bytes += Chunk->Used;
+        }
+
+        return Bytes;
+    }
+
+    const size_t GetReservedBytes() const {
+        size_t Bytes = 0;
+        for (auto Chunk = Head; Chunk != nullptr; Chunk = Chunk->Next) {
+            Bytes += Chunk->Size;
+        }
+
+        return Bytes;
+    }
+
+    const size_t GetChunkCount() const {
+        size_t Count = 0;
+        for (auto Chunk = Head; Chunk != nullptr; Chunk = Chunk->Next) {
+            ++Count;
+        }
+
+        return Count;
+    }
+
+private:
+    void *AllocateSlow(size_t Size, size_t Align) {
+        if (Current != nullptr) {
+            for (auto Chunk = Current->Next; Chunk != nullptr; Chunk = Chunk->Next) {
+                if (Chunk->Used == 0 && Size + Align <= Chunk->Size) {
+                    Current = Chunk;
+                    return Allocate(Size, Align);
+                }
+            }
+        }
+
+        size_t Capacity = NextChunkSize;
+        if (Capacity < Size + Align) {
+            Capacity = Size + Align;
+        } else if (NextChunkSize < MaxChunkSize) {
+            NextChunkSize *= 2;
+        }
+
+        auto Chunk = static_cast<sJSONArenaChunk *>(::operator new(sizeof(sJSONArenaChunk) + Capacity));
+        Chunk->Size = Capacity;
+        Chunk->Used = 0;
+        if (Current == nullptr) {
+            Chunk->Next = Head;
+            Head = Chunk;
+        } else {
+            Chunk->Next = Current->Next;
+            Current->Next = Chunk;
+        }
+        Current = Chunk;
+
+        return Allocate(Size, Align);
+    }
+
+private:
+    sJSONArenaChunk *Head;
+    sJSONArenaChunk *Current;
+    size_t ChunkSize;
+    size_t NextChunkSize;
+};
+
+// Standard allocator over an sJSONArena. Without an arena it falls back to the global heap, so
+// containers of nodes built by hand outside of a document keep working.
+template<class Type>
+class sJSONArenaAllocator {
+public:
+    using value_type = Type;
+
+public:
+    sJSONArenaAllocator(sJSONArena *Arena = nullptr) noexcept : Arena(Arena) {
+    }
+
+    template<class Other>
+    sJSONArenaAllocator(const sJSONArenaAllocator<Other> &Allocator) noexcept : Arena(Allocator.Arena) {
+    }
+
+public:
+    Type *allocate(size_t Count) {
+        if (Arena != nullptr) {
+            return static_cast<Type *>(Arena->Allocate(sizeof(Type) * Count, alignof(Type)));
+        }
+
+        return static_cast<Type *>(::operator new(sizeof(Type) * Count));
+    }
+
+    void deallocate(Type *Pointer, size_t) noexcept {
+        if (Arena == nullptr) {
+            ::operator delete(Pointer);
+        }
+    }
+
+    template<class Other>
+    bool operator==(const sJSONArenaAllocator<Other> &Allocator) const noexcept {
+        return Arena == Allocator.Arena;
+    }
+
+    template<class Other>
+    bool operator!=(const sJSONArenaAllocator<Other> &Allocator) const noexcept {
+        return Arena != Allocator.Arena;
+    }
+
+public:
+    sJSONArena *Arena;
+};
+
+// Where a container sits in the tree and which revision of it this is. Editing a container through
+// its mutation methods gives it and every container above it a new revision, which is how
+// sJSONWriter::WriteCached tells the subtrees it can reuse from those it has to write again, and how
+// sJSONComparer knows whether Hash, computed at HashRevision, still holds.
+struct sJSONEditState {
+    sJSONEditState *Parent = nullptr;
+    uint64_t Revision = 0;
+    uint64_t Hash = 0;
+    uint64_t HashRevision = ~0ULL;
+
+    // Revisions are unique across all trees, so a stale cache entry can never match a new node.
+    static uint64_t NextRevision() {
+        static std::atomic<uint64_t> Counter(0);
+
+        return Counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void Invalidate() {
+        for (auto State = this; State != nullptr; State = State->Parent) {
+            State->Revision = NextRevision();
+        }
+    }
+};
+
 class sJSONValue {
 public:
     sJSONValue() = default;
@@ -60,6 +342,11 @@ public:
         return 0;
     }
 
+    // Containers have one; scalars do not.
+    virtual sJSONEditState *GetEditState() {
+        return nullptr;
+    }
+
     template<class Object>
     Object To() {
         return static_cast<Object>(this);
@@ -91,17 +378,24 @@ public:
     }
 
     __forceinline const size_t GetHash() const override {
-        return typeid(Type).hash_code();
+        return TypeHash();
     }
 
     static constexpr bool Equal(const sJSONValue *Judgement) {
         if (Judgement->GetType() != sJSONValueType::Value) {
             return false;
         } else {
-            return Judgement->GetHash() == typeid(Type).hash_code();
+            return Judgement->GetHash() == TypeHash();
         }
     }
 
+    // hash_code() hashes the type name on every call, so it is taken once.
+    static size_t TypeHash() {
+        static const size_t Hash = typeid(Type).hash_code();
+
+        return Hash;
+    }
+
     Type operator*() {
         return Value;
     }
@@ -110,14 +404,20 @@ public:
     Type Value;
 };
 
-using sJSONstring = sJSONRealValue<std::string>;
+using sJSONstring = sJSONRealValue<std::string_view>;
 using sJSONInt = sJSONRealValue<int>;
 using sJSONDouble = sJSONRealValue<double>;
 using sJSONBoolean = sJSONRealValue<bool>;
+using sJSONInt64 = sJSONRealValue<int64_t>;
+using sJSONUInt64 = sJSONRealValue<uint64_t>;
 
 class sJSONArray : public sJSONValue {
 public:
-    sJSONArray() = default;
+    using ValueList = std::vector<sJSONValue *, sJSONArenaAllocator<sJSONValue *>>;
+
+public:
+    sJSONArray(sJSONArena *Arena = nullptr) : ValueSet(Arena) {
+    }
 
     ~sJSONArray() = default;
 
@@ -126,733 +426,8587 @@ public:
         return sJSONValueType::Array;
     }
 
-public:
-    std::vector<sJSONValue *> ValueSet;
-};
+    sJSONEditState *GetEditState() override {
+        return &Edit;
+    }
 
-typedef class sJSONElementNode : public sJSONValue {
 public:
-    sJSONElementNode() {
-        Value = nullptr;
+    // Edits that keep the text cached by sJSONWriter::WriteCached in step with the tree. After changing
+    // ValueSet or an element in place, call Invalidate() instead.
+    void Set(size_t Index, sJSONValue *Value) {
+        Adopt(Value);
+        ValueSet[Index] = Value;
+        Edit.Invalidate();
     }
 
-    sJSONElementNode(const std::string &Tag, sJSONValue *Value) {
-        this->Tag = Tag;
-        this->Value = Value;
+    void Insert(size_t Index, sJSONValue *Value) {
+        Adopt(Value);
+        ValueSet.insert(ValueSet.begin() + Index, Value);
+        Edit.Invalidate();
     }
 
-    sJSONElementNode(std::map<std::string, sJSONElementNode *> SetChildren) : Children(SetChildren), Value(nullptr) {
+    void Append(sJSONValue *Value) {
+        Adopt(Value);
+        ValueSet.push_back(Value);
+        Edit.Invalidate();
     }
 
-    ~sJSONElementNode() {}
+    void Remove(size_t Index) {
+        ValueSet.erase(ValueSet.begin() + Index);
+        Edit.Invalidate();
+    }
 
-public:
-    __forceinline sJSONValueType const GetType() const override {
-        return sJSONValueType::Object;
+    void Invalidate() {
+        Edit.Invalidate();
     }
 
-    template<class Type>
-    Type To() {
-        return Value->To<Type>();
+private:
+    void Adopt(sJSONValue *Value) {
+        if (auto State = Value->GetEditState()) {
+            State->Parent = &Edit;
+        }
     }
 
 public:
-    bool IsEmpty() {
-        return Value->GetType() == sJSONValueType::Null;
-    }
+    ValueList ValueSet;
+    sJSONEditState Edit;
+};
 
-    const std::string GetTag() const {
-        return Tag;
+constexpr uint64_t sJSONHashKey(std::string_view Key) {
+    uint64_t Hash = 14695981039346656037ULL;
+    for (auto Character : Key) {
+        Hash ^= static_cast<unsigned char>(Character);
+        Hash *= 1099511628211ULL;
     }
 
-    void InsertChildrenNode(sJSONElementNode *Node) {
-        Children.emplace(Node->Tag, Node);
-    }
+    return Hash;
+}
 
-    const sJSONValue *GetValue() const {
-        return Value;
+// Interned key handed out by sJSONKeyPool. Keys from the same pool are equal exactly when their
+// text pointers are, and Hash is the sJSONHashKey of the text.
+struct sJSONKey {
+    std::string_view Text;
+    uint64_t Hash;
+
+    bool operator==(const sJSONKey &Other) const {
+        return Text.data() == Other.Text.data();
     }
 
-    sJSONValue *operator*() {
-        return Value;
+    bool operator!=(const sJSONKey &Other) const {
+        return Text.data() != Other.Text.data();
     }
+};
 
+struct sJSONKeyPoolStats {
+    size_t Keys;
+    size_t Bytes;
+    size_t ReservedBytes;
+    size_t Lookups;
+    size_t Hits;
+    size_t SavedBytes;
+};
+
+// Thread-safe key interning shared by any number of parsers and documents, which must not outlive it.
+// Keys are split across shards by hash so that concurrent parsers rarely wait on the same lock.
+class sJSONKeyPool {
 public:
-    sJSONElementNode *operator[](const std::string &ChildrenTag) {
-        return Children[ChildrenTag];
-    }
+    static constexpr size_t ShardCount = 16;
 
 public:
-    sJSONValue *Value;
-    std::string Tag;
-    std::map<std::string, sJSONElementNode *> Children;
-} sJSONObject;
+    sJSONKeyPool() = default;
+
+    sJSONKeyPool(const sJSONKeyPool &) = delete;
+
+    sJSONKeyPool &operator=(const sJSONKeyPool &) = delete;
 
-class sJSONElementFinder {
 public:
-    sJSONElementFinder(sJSONElementNode *Ptr) : Value(Ptr) {
+    sJSONKey Intern(std::string_view Key) {
+        return Intern(Key, sJSONHashKey(Key));
     }
 
-    sJSONElementFinder operator[](const std::string &Finder) {
-        return sJSONElementFinder(Value->operator[](Finder));
-    }
+    sJSONKey Intern(std::string_view Key, uint64_t Hash) {
+        auto &Target = Shards[Hash >> 60];
+        std::lock_guard<std::mutex> Lock(Target.Lock);
 
-    sJSONValue *GetValue() {
-        return Value->Value;
-    }
+        ++Target.Lookups;
+        if (Target.Table.empty()) {
+            Target.Table.assign(64, sJSONKey{std::string_view(), 0});
+        }
 
-    bool IsEmpty() {
-        return Value->Value->GetType() == sJSONValueType::Null;
-    }
+        size_t Slot = FindSlot(Target, Key, Hash);
+        if (Target.Table[Slot].Text.data() != nullptr) {
+            ++Target.Hits;
+            Target.SavedBytes += Key.size();
+            return Target.Table[Slot];
+        }
 
-    bool IsArray() {
-        return Value->Value->GetType() == sJSONValueType::Array;
-    }
+        auto Buffer = static_cast<char *>(Target.Arena.Allocate(Key.size() + 1, 1));
+        memcpy(Buffer, Key.data(), Key.size());
+        Buffer[Key.size()] = '\0';
+        sJSONKey Result{std::string_view(Buffer, Key.size()), Hash};
 
-    bool IsObject() {
-        return Value->Value->GetType() == sJSONValueType::Object;
-    }
+        Target.Table[Slot] = Result;
+        ++Target.Count;
+        Target.Bytes += Key.size();
+        if (Target.Count * 2 > Target.Table.size()) {
+            Grow(Target);
+        }
 
-    bool IsRealValue() {
-        return Value->Value->GetType() == sJSONValueType::Value;
+        return Result;
     }
 
-    bool Exsits(const std::string &Finder) {
-        return Value->Children.find(Finder) != Value->Children.end();
+    // Looks a key up without interning it. The returned key has a null text when it is unknown.
+    sJSONKey Find(std::string_view Key) {
+        uint64_t Hash = sJSONHashKey(Key);
+        auto &Target = Shards[Hash >> 60];
+        std::lock_guard<std::mutex> Lock(Target.Lock);
+        if (Target.Table.empty()) {
+            return sJSONKey{std::string_view(), Hash};
+        }
+
+        return Target.Table[FindSlot(Target, Key, Hash)];
     }
 
-    template<class Type>
-    Type To() {
-        return Value->To<Type>();
+    sJSONKeyPoolStats GetStats() {
+        sJSONKeyPoolStats Stats{0, 0, 0, 0, 0, 0};
+        for (auto &Target : Shards) {
+            std::lock_guard<std::mutex> Lock(Target.Lock);
+            Stats.Keys += Target.Count;
+            Stats.Bytes += Target.Bytes;
+            Stats.ReservedBytes += Target.Arena.GetReservedBytes() + Target.Table.capacity() * sizeof(sJSONKey);
+            Stats.Lookups += Target.Lookups;
+            Stats.Hits += Target.Hits;
+            Stats.SavedBytes += Target.SavedBytes;
+        }
+
+        return Stats;
     }
 
-    std::map<std::string, sJSONElementNode *>::iterator begin() {
-        Iterator = Value->Children.begin();
+private:
+    struct Shard {
+        Shard() : Arena(4096), Count(0), Bytes(0), Lookups(0), Hits(0), SavedBytes(0) {
+        }
+
+        std::mutex Lock;
+        sJSONArena Arena;
+        std::vector<sJSONKey> Table;
+        size_t Count;
+        size_t Bytes;
+        size_t Lookups;
+        size_t Hits;
+        size_t SavedBytes;
+    };
+
+    static size_t FindSlot(Shard &Target, std::string_view Key, uint64_t Hash) {
+        size_t Mask = Target.Table.size() - 1;
+        size_t Slot = static_cast<size_t>(Hash) & Mask;
+        while (Target.Table[Slot].Text.data() != nullptr &&
+               (Target.Table[Slot].Hash != Hash || Target.Table[Slot].Text != Key)) {
+            Slot = (Slot + 1) & Mask;
+        }
 
-        return Iterator;
+        return Slot;
     }
 
-    std::map<std::string, sJSONElementNode *>::iterator end() {
-        return Value->Children.end();
+    static void Grow(Shard &Target) {
+        std::vector<sJSONKey> Table(Target.Table.size() * 2, sJSONKey{std::string_view(), 0});
+        std::swap(Table, Target.Table);
+        for (auto &Key : Table) {
+            if (Key.Text.data() != nullptr) {
+                Target.Table[FindSlot(Target, Key.Text, Key.Hash)] = Key;
+            }
+        }
     }
 
-    auto operator++() {
-        ++Iterator;
+private:
+    Shard Shards[ShardCount];
+};
 
-        return *Iterator;
+// Object members kept contiguously in insertion order. Small objects are searched linearly; past
+// IndexThreshold members an open-addressing index of member positions is kept next to them. The
+// first occurrence of a duplicated key wins.
+class sJSONMemberTable {
+public:
+    using Member = std::pair<std::string_view, sJSONElementNode *>;
+    using MemberList = std::vector<Member, sJSONArenaAllocator<Member>>;
+    using iterator = MemberList::iterator;
+    using const_iterator = MemberList::const_iterator;
+
+    static constexpr size_t IndexThreshold = 8;
+
+public:
+    sJSONMemberTable(sJSONArena *Arena = nullptr) : Members(Arena), Index(Arena) {
     }
 
-    auto operator++(int) {
-        auto Temp(*Iterator);
-        ++Iterator;
+public:
+    sJSONElementNode *Find(std::string_view Key) const {
+        return Find(Key, Index.empty() ? 0 : sJSONHashKey(Key));
+    }
 
-        return Temp;
+    // Lookup with a pooled key: no hashing, and interned member keys match by pointer.
+    sJSONElementNode *Find(const sJSONKey &Key) const {
+        return Find(Key.Text, Key.Hash);
     }
 
-    std::vector<sJSONValue *>::iterator ArrayBegin() {
-        if (Value->Value->GetType() == sJSONValueType::Array) {
-            return Value->Value->To<sJSONArray *>()->ValueSet.begin();
+    bool Insert(std::string_view Key, sJSONElementNode *Node) {
+        if (Index.empty()) {
+            if (Find(Key) != nullptr) {
+                return false;
+            }
+
+            Members.emplace_back(Key, Node);
+            if (Members.size() > IndexThreshold) {
+                Rehash(Members.size());
+            }
+
+            return true;
         }
 
-        return std::vector<sJSONValue *>::iterator();
-    }
+        size_t Slot = FindSlot(Key, sJSONHashKey(Key));
+        if (Index[Slot] != 0) {
+            return false;
+        }
 
-    std::vector<sJSONValue *>::iterator ArrayEnd() {
-        if (Value->Value->GetType() == sJSONValueType::Array) {
-            return Value->Value->To<sJSONArray *>()->ValueSet.end();
+        Members.emplace_back(Key, Node);
+        Index[Slot] = static_cast<uint32_t>(Members.size());
+        if (Members.size() * 2 > Index.size()) {
+            Rehash(Members.size());
         }
 
-        return std::vector<sJSONValue *>::iterator();
+        return true;
     }
 
-private:
-    std::map<std::string, sJSONElementNode *>::iterator Iterator;
-    sJSONElementNode *Value;
-};
+    bool Erase(std::string_view Key) {
+        for (auto Iterator = Members.begin(); Iterator != Members.end(); ++Iterator) {
+            if (SameKey(Iterator->first, Key)) {
+                Members.erase(Iterator);
+                if (Members.size() > IndexThreshold) {
+                    Rehash(Members.size());
+                } else {
+                    Index.clear();
+                }
 
-class sJSONRootNode {
-public:
-    sJSONRootNode(sJSONObject *RootObject) : Object(RootObject) {
+                return true;
+            }
+        }
+
+        return false;
     }
 
-public:
-    sJSONElementFinder operator[](const std::string &ChildrenTag) {
-        return sJSONElementFinder(Object->operator[](ChildrenTag));
+    // Replaces the content with [Begin, End) in one allocation, dropping later duplicates.
+    void Assign(const Member *Begin, const Member *End) {
+        Members.clear();
+        Index.clear();
+        Members.reserve(End - Begin);
+        if (static_cast<size_t>(End - Begin) > IndexThreshold) {
+            Index.assign(IndexCapacity(End - Begin), 0);
+        }
+
+        for (auto Iterator = Begin; Iterator != End; ++Iterator) {
+            Insert(Iterator->first, Iterator->second);
+        }
     }
 
-    bool Exsits(const std::string &Finder) {
-        return Object->Children.find(Finder) != Object->Children.end();
+    const size_t Size() const {
+        return Members.size();
     }
 
-    std::map<std::string, sJSONElementNode *>::iterator begin() {
-        Iterator = Object->Children.begin();
+    const bool Empty() const {
+        return Members.empty();
+    }
 
-        return Iterator;
+    Member &At(size_t Position) {
+        return Members[Position];
     }
 
-    std::map<std::string, sJSONElementNode *>::iterator end() {
-        return Object->Children.end();
+    sJSONArena *GetArena() const {
+        return Members.get_allocator().Arena;
     }
 
-    auto operator++() {
-        ++Iterator;
+    iterator begin() {
+        return Members.begin();
+    }
 
-        return *Iterator;
+    iterator end() {
+        return Members.end();
     }
 
-    auto operator++(int) {
-        auto Temp(*Iterator);
-        ++Iterator;
+    const_iterator begin() const {
+        return Members.begin();
+    }
 
-        return Temp;
+    const_iterator end() const {
+        return Members.end();
     }
 
 private:
-    std::map<std::string, sJSONElementNode *>::iterator Iterator;
-    sJSONObject *Object;
-};
+    static __forceinline bool SameKey(std::string_view Left, std::string_view Right) {
+        return (Left.data() == Right.data() && Left.size() == Right.size()) || Left == Right;
+    }
 
-class sJSONParserStatus {
-public:
-    using ErrorList = std::vector<std::string>;
-    using Iterator = std::vector<std::string>::iterator;
+    sJSONElementNode *Find(std::string_view Key, uint64_t Hash) const {
+        if (Index.empty()) {
+            for (auto &Instance : Members) {
+                if (SameKey(Instance.first, Key)) {
+                    return Instance.second;
+                }
+            }
 
-public:
-    sJSONParserStatus() = default;
+            return nullptr;
+        }
 
-    __forceinline const bool ExsitsError() const {
-        return !ErrorInfo.empty();
+        size_t Slot = FindSlot(Key, Hash);
+        return Index[Slot] == 0 ? nullptr : Members[Index[Slot] - 1].second;
     }
 
-    std::vector<std::string>::iterator begin() {
-        NativeIterator = ErrorInfo.begin();
-        return NativeIterator;
-    }
+    static size_t IndexCapacity(size_t Count) {
+        size_t Capacity = 16;
+        while (Capacity < Count * 2) {
+            Capacity *= 2;
+        }
 
-    std::vector<std::string>::iterator end() {
-        return ErrorInfo.end();
+        return Capacity;
     }
 
-    std::string &operator++() {
-        ++NativeIterator;
+    size_t FindSlot(std::string_view Key, uint64_t Hash) const {
+        size_t Mask = Index.size() - 1;
+        size_t Slot = static_cast<size_t>(Hash) & Mask;
+        while (Index[Slot] != 0 && !SameKey(Members[Index[Slot] - 1].first, Key)) {
+            Slot = (Slot + 1) & Mask;
+        }
 
-        return *NativeIterator;
+        return Slot;
     }
 
-    std::string operator++(int) {
-        std::string Temp(*NativeIterator);
-        ++NativeIterator;
-
-        return Temp;
+    void Rehash(size_t Count) {
+        Index.assign(IndexCapacity(Count), 0);
+        for (size_t Position = 0; Position < Members.size(); ++Position) {
+            Index[FindSlot(Members[Position].first, sJSONHashKey(Members[Position].first))] =
+                    static_cast<uint32_t>(Position + 1);
+        }
     }
 
+private:
+    MemberList Members;
+    std::vector<uint32_t, sJSONArenaAllocator<uint32_t>> Index;
+};
+
+typedef class sJSONElementNode : public sJSONValue {
+public:
+    sJSONElementNode(sJSONArena *Arena = nullptr) : Value(nullptr), Children(Arena) {
+    }
+
+    sJSONElementNode(std::string_view Tag, sJSONValue *Value, sJSONArena *Arena = nullptr)
+            : Value(Value), Tag(Tag), Children(Arena) {
+    }
+
+    sJSONElementNode(const sJSONMemberTable &SetChildren) : Value(nullptr), Children(SetChildren) {
+    }
+
+    ~sJSONElementNode() {}
+
+public:
+    __forceinline sJSONValueType const GetType() const override {
+        return sJSONValueType::Object;
+    }
+
+    sJSONEditState *GetEditState() override {
+        return &Edit;
+    }
+
+    template<class Type>
+    Type To() {
+        return Value->To<Type>();
+    }
+
+public:
+    bool IsEmpty() {
+        return Value->GetType() == sJSONValueType::Null;
+    }
+
+    std::string_view GetTag() const {
+        return Tag;
+    }
+
+    void InsertChildrenNode(sJSONElementNode *Node) {
+        Node->Edit.Parent = &Edit;
+        Children.Insert(Node->Tag, Node);
+    }
+
+    // Members of the object this node stands for: its own when it is an object, or those of the
+    // object value it is tagged with.
+    sJSONMemberTable &GetChildren() {
+        if (Value != nullptr && Value->GetType() == sJSONValueType::Object) {
+            return static_cast<sJSONElementNode *>(Value)->Children;
+        }
+
+        return Children;
+    }
+
+    const sJSONValue *GetValue() const {
+        return Value;
+    }
+
+    sJSONValue *operator*() {
+        return Value;
+    }
+
+public:
+    // Edits of the object this node stands for that keep the text cached by sJSONWriter::WriteCached in
+    // step with the tree. Keys are copied into the arena of the object; an object made without one gets
+    // a small arena of its own for them on the first Set. After changing Children in place, call
+    // Invalidate() on this node; after changing a member value in place, on the member node.
+    void Set(std::string_view Key, sJSONValue *NewValue) {
+        auto Object = GetObjectNode();
+        if (auto State = NewValue->GetEditState()) {
+            State->Parent = &Object->Edit;
+        }
+
+        if (auto Member = Object->Children.Find(Key)) {
+            Member->Value = NewValue;
+            Member->Edit.Parent = &Object->Edit;
+        } else {
+            auto Arena = Object->Children.GetArena();
+            if (Arena == nullptr) {
+                if (Object->OwnedArena == nullptr) {
+                    Object->OwnedArena = std::make_unique<sJSONArena>(OwnedChunkSize);
+                }
+                Arena = Object->OwnedArena.get();
+            }
+
+            auto Buffer = static_cast<char *>(Arena->Allocate(Key.size() + 1, 1));
+            memcpy(Buffer, Key.data(), Key.size());
+            Buffer[Key.size()] = '\0';
+            Key = std::string_view(Buffer, Key.size());
+            auto Node = Arena->Create<sJSONElementNode>(Key, NewValue, Arena);
+            Node->Edit.Parent = &Object->Edit;
+            Object->Children.Insert(Key, Node);
+        }
+        Object->Edit.Invalidate();
+    }
+
+    bool Remove(std::string_view Key) {
+        auto Object = GetObjectNode();
+        if (!Object->Children.Erase(Key)) {
+            return false;
+        }
+        Object->Edit.Invalidate();
+
+        return true;
+    }
+
+    // A member node holding a container passes this on to the container; one holding a scalar is
+    // linked to the object it is a member of, which is what has to be written again.
+    void Invalidate() {
+        if (Value != nullptr) {
+            if (auto State = Value->GetEditState()) {
+                State->Invalidate();
+                return;
+            }
+        }
+
+        Edit.Invalidate();
+    }
+
+public:
+    sJSONElementNode *operator[](std::string_view ChildrenTag) {
+        return GetChildren().Find(ChildrenTag);
+    }
+
+    sJSONElementNode *operator[](const sJSONKey &ChildrenTag) {
+        return GetChildren().Find(ChildrenTag);
+    }
+
+private:
+    static constexpr size_t OwnedChunkSize = 1024;
+
+    sJSONElementNode *GetObjectNode() {
+        if (Value != nullptr && Value->GetType() == sJSONValueType::Object) {
+            return static_cast<sJSONElementNode *>(Value);
+        }
+
+        return this;
+    }
+
+public:
+    sJSONValue *Value;
+    std::string_view Tag;
+    sJSONMemberTable Children;
+    sJSONEditState Edit;
+
+private:
+    std::unique_ptr<sJSONArena> OwnedArena;
+} sJSONObject;
+
+class sJSONElementFinder {
+public:
+    sJSONElementFinder(sJSONElementNode *Ptr) : Value(Ptr) {
+    }
+
+    sJSONElementFinder operator[](std::string_view Finder) {
+        return sJSONElementFinder(Value->operator[](Finder));
+    }
+
+    sJSONElementFinder operator[](const sJSONKey &Finder) {
+        return sJSONElementFinder(Value->operator[](Finder));
+    }
+
+    sJSONValue *GetValue() {
+        return Value->Value;
+    }
+
+    sJSONElementNode *GetNode() {
+        return Value;
+    }
+
+    bool IsEmpty() {
+        return Value->Value->GetType() == sJSONValueType::Null;
+    }
+
+    bool IsArray() {
+        return Value->Value->GetType() == sJSONValueType::Array;
+    }
+
+    bool IsObject() {
+        return Value->Value->GetType() == sJSONValueType::Object;
+    }
+
+    bool IsRealValue() {
+        return Value->Value->GetType() == sJSONValueType::Value;
+    }
+
+    bool Exsits(std::string_view Finder) {
+        return Value->GetChildren().Find(Finder) != nullptr;
+    }
+
+    template<class Type>
+    Type To() {
+        return Value->To<Type>();
+    }
+
+    sJSONMemberTable::iterator begin() {
+        Iterator = Value->GetChildren().begin();
+
+        return Iterator;
+    }
+
+    sJSONMemberTable::iterator end() {
+        return Value->GetChildren().end();
+    }
+
+    auto operator++() {
+        ++Iterator;
+
+        return *Iterator;
+    }
+
+    auto operator++(int) {
+        auto Temp(*Iterator);
+        ++Iterator;
+
+        return Temp;
+    }
+
+    sJSONArray::ValueList::iterator ArrayBegin() {
+        if (Value->Value->GetType() == sJSONValueType::Array) {
+            return Value->Value->To<sJSONArray *>()->ValueSet.begin();
+        }
+
+        return sJSONArray::ValueList::iterator();
+    }
+
+    sJSONArray::ValueList::iterator ArrayEnd() {
+        if (Value->Value->GetType() == sJSONValueType::Array) {
+            return Value->Value->To<sJSONArray *>()->ValueSet.end();
+        }
+
+        return sJSONArray::ValueList::iterator();
+    }
+
+private:
+    sJSONMemberTable::iterator Iterator;
+    sJSONElementNode *Value;
+};
+
+class sJSONRootNode {
+public:
+    sJSONRootNode(sJSONObject *RootObject) : Object(RootObject) {
+    }
+
+public:
+    sJSONObject *GetObject() {
+        return Object;
+    }
+
+    sJSONElementFinder operator[](std::string_view ChildrenTag) {
+        return sJSONElementFinder(Object->operator[](ChildrenTag));
+    }
+
+    sJSONElementFinder operator[](const sJSONKey &ChildrenTag) {
+        return sJSONElementFinder(Object->operator[](ChildrenTag));
+    }
+
+    bool Exsits(std::string_view Finder) {
+        return Object->Children.Find(Finder) != nullptr;
+    }
+
+    sJSONMemberTable::iterator begin() {
+        Iterator = Object->Children.begin();
+
+        return Iterator;
+    }
+
+    sJSONMemberTable::iterator end() {
+        return Object->Children.end();
+    }
+
+    auto operator++() {
+        ++Iterator;
+
+        return *Iterator;
+    }
+
+    auto operator++(int) {
+        auto Temp(*Iterator);
+        ++Iterator;
+
+        return Temp;
+    }
+
+private:
+    sJSONMemberTable::iterator Iterator;
+    sJSONObject *Object;
+};
+
+struct sJSONMemoryUsage {
+    size_t UsedBytes;
+    size_t ReservedBytes;
+    size_t Chunks;
+};
+
+class sJSONFrozenDocument;
+
+// Owns every node and string of a parsed tree. Destroying or resetting the document releases the
+// whole tree at once; Reset() keeps the arena chunks so the next parse can reuse them.
+class sJSONDocument {
+public:
+    explicit sJSONDocument(size_t ChunkSize = sJSONArena::DefaultChunkSize) : Arena(ChunkSize), RootObject(nullptr) {
+    }
+
+    sJSONDocument(const sJSONDocument &) = delete;
+
+    sJSONDocument &operator=(const sJSONDocument &) = delete;
+
+    sJSONDocument(sJSONDocument &&Other) noexcept : Arena(std::move(Other.Arena)), RootObject(Other.RootObject) {
+        Other.RootObject = nullptr;
+    }
+
+    sJSONDocument &operator=(sJSONDocument &&Other) noexcept {
+        Arena = std::move(Other.Arena);
+        RootObject = Other.RootObject;
+        Other.RootObject = nullptr;
+
+        return *this;
+    }
+
+public:
+    template<class Type, class... Args>
+    Type *Create(Args &&...Arguments) {
+        return Arena.Create<Type>(std::forward<Args>(Arguments)...);
+    }
+
+    sJSONObject *CreateObject() {
+        return Arena.Create<sJSONObject>(&Arena);
+    }
+
+    sJSONElementNode *CreateNode(std::string_view Tag, sJSONValue *Value) {
+        return Arena.Create<sJSONElementNode>(Tag, Value, &Arena);
+    }
+
+    sJSONArray *CreateArray() {
+        return Arena.Create<sJSONArray>(&Arena);
+    }
+
+    std::string_view CreateString(std::string_view String) {
+        auto Buffer = static_cast<char *>(Arena.Allocate(String.size() + 1, 1));
+        memcpy(Buffer, String.data(), String.size());
+        Buffer[String.size()] = '\0';
+
+        return std::string_view(Buffer, String.size());
+    }
+
+    sJSONObject *GetRootObject() {
+        if (RootObject == nullptr) {
+            RootObject = CreateObject();
+        }
+
+        return RootObject;
+    }
+
+    void SetRootObject(sJSONObject *Object) {
+        RootObject = Object;
+    }
+
+    sJSONRootNode GetRoot() {
+        return sJSONRootNode(GetRootObject());
+    }
+
+    sJSONArena &GetArena() {
+        return Arena;
+    }
+
+    // What the tree costs: the bytes its nodes, strings and tables take up, and the memory held for it.
+    sJSONMemoryUsage GetMemoryUsage() const {
+        return {Arena.GetUsedBytes(), Arena.GetReservedBytes(), Arena.GetChunkCount()};
+    }
+
+    void Reset() {
+        RootObject = nullptr;
+        Arena.Reset();
+    }
+
+    // Immutable copy of the tree that threads can share; see sJSONFrozenDocument.
+    sJSONFrozenDocument Freeze();
+
+private:
+    sJSONArena Arena;
+    sJSONObject *RootObject;
+};
+
+class sJSONParserStatus {
+public:
+    using ErrorList = std::vector<std::string>;
+    using Iterator = std::vector<std::string>::iterator;
+
+public:
+    sJSONParserStatus() = default;
+
+    __forceinline const bool ExsitsError() const {
+        return !ErrorInfo.empty();
+    }
+
+    std::vector<std::string>::iterator begin() {
+        NativeIterator = ErrorInfo.begin();
+        return NativeIterator;
+    }
+
+    std::vector<std::string>::iterator end() {
+        return ErrorInfo.end();
+    }
+
+    std::string &operator++() {
+        ++NativeIterator;
+
+        return *NativeIterator;
+    }
+
+    std::string operator++(int) {
+        std::string Temp(*NativeIterator);
+        ++NativeIterator;
+
+        return Temp;
+    }
+
+public:
+    ErrorList ErrorInfo;
+    Iterator NativeIterator;
+};
+
+struct sJSONNodeCount {
+    size_t Count;
+    size_t Bytes;
+};
+
+// Measurements of one parse, collected only while an sJSONStatsObserver is attached. Node bytes are
+// those of the node objects themselves; key and string text and member tables make up the rest of
+// ArenaBytes. LexSeconds is the structural scan of the input and BuildSeconds everything else:
+// reading the tokens and building the tree.
+struct sJSONParseStats {
+    size_t BytesConsumed;
+    size_t Tokens;
+    size_t MaxDepth;
+    sJSONNodeCount Objects;
+    sJSONNodeCount Arrays;
+    sJSONNodeCount Members;
+    sJSONNodeCount Strings;
+    sJSONNodeCount Numbers;
+    sJSONNodeCount Literals;
+    size_t ArenaBytes;
+    size_t ArenaChunks;
+    double LexSeconds;
+    double BuildSeconds;
+    bool Failed;
+};
+
+struct sJSONWriteStats {
+    size_t Bytes;
+    double Seconds;
+    bool Format;
+};
+
+// Hook for forwarding parse and write measurements, e.g. to a metrics system. Calls come from the
+// thread doing the work, right after it is done.
+class sJSONStatsObserver {
+public:
+    virtual ~sJSONStatsObserver() = default;
+
+public:
+    virtual void OnParse(const sJSONParseStats &/* Stats */) {
+    }
+
+    virtual void OnWrite(const sJSONWriteStats &/* Stats */) {
+    }
+};
+
+// Observer that keeps the latest measurements and running totals. Not synchronised; use one per thread.
+class sJSONStatsRecorder : public sJSONStatsObserver {
+public:
+    sJSONStatsRecorder() : LastParse(), LastWrite(), Parses(0), Failures(0), ParsedBytes(0), ParseSeconds(0),
+                           MaxDepth(0), Writes(0), WrittenBytes(0), WriteSeconds(0) {
+    }
+
+public:
+    void OnParse(const sJSONParseStats &Stats) override {
+        LastParse = Stats;
+        ++Parses;
+        Failures += Stats.Failed ? 1 : 0;
+        ParsedBytes += Stats.BytesConsumed;
+        ParseSeconds += Stats.LexSeconds + Stats.BuildSeconds;
+        MaxDepth = Stats.MaxDepth > MaxDepth ? Stats.MaxDepth : MaxDepth;
+    }
+
+    void OnWrite(const sJSONWriteStats &Stats) override {
+        LastWrite = Stats;
+        ++Writes;
+        WrittenBytes += Stats.Bytes;
+        WriteSeconds += Stats.Seconds;
+    }
+
+public:
+    sJSONParseStats LastParse;
+    sJSONWriteStats LastWrite;
+    size_t Parses;
+    size_t Failures;
+    size_t ParsedBytes;
+    double ParseSeconds;
+    size_t MaxDepth;
+    size_t Writes;
+    size_t WrittenBytes;
+    double WriteSeconds;
+};
+
+enum class sJSONSIMDLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Bit i of each mask describes byte i of a 64-byte block.
+struct sJSONBlockMasks {
+    uint64_t Quote;
+    uint64_t Backslash;
+    uint64_t Operator;
+    uint64_t Space;
+    uint64_t Newline;
+};
+
+struct sJSONCharacterClassTable {
+    static constexpr unsigned char Quote = 1;
+    static constexpr unsigned char Backslash = 2;
+    static constexpr unsigned char Operator = 4;
+    static constexpr unsigned char Space = 8;
+
+    constexpr sJSONCharacterClassTable() : Class() {
+        Class[static_cast<unsigned char>('"')] = Quote;
+        Class[static_cast<unsigned char>('\\')] = Backslash;
+        Class[static_cast<unsigned char>('{')] = Operator;
+        Class[static_cast<unsigned char>('}')] = Operator;
+        Class[static_cast<unsigned char>('[')] = Operator;
+        Class[static_cast<unsigned char>(']')] = Operator;
+        Class[static_cast<unsigned char>(',')] = Operator;
+        Class[static_cast<unsigned char>(':')] = Operator;
+        Class[static_cast<unsigned char>(' ')] = Space;
+        Class[static_cast<unsigned char>('\t')] = Space;
+        Class[static_cast<unsigned char>('\n')] = Space;
+        Class[static_cast<unsigned char>('\r')] = Space;
+    }
+
+    unsigned char Class[256];
+};
+
+inline constexpr sJSONCharacterClassTable sJSONCharacterClasses;
+
+inline void sJSONClassifyScalar(const char *Block, sJSONBlockMasks &Masks) {
+    Masks = {0, 0, 0, 0, 0};
+    for (int Count = 0; Count < 64; ++Count) {
+        uint64_t Class = sJSONCharacterClasses.Class[static_cast<unsigned char>(Block[Count])];
+        Masks.Quote |= (Class & sJSONCharacterClassTable::Quote) << Count;
+        Masks.Backslash |= ((Class & sJSONCharacterClassTable::Backslash) >> 1) << Count;
+        Masks.Operator |= ((Class & sJSONCharacterClassTable::Operator) >> 2) << Count;
+        Masks.Space |= ((Class & sJSONCharacterClassTable::Space) >> 3) << Count;
+        Masks.Newline |= static_cast<uint64_t>(Block[Count] == '\n') << Count;
+    }
+}
+
+#ifdef sJSON_X86_64
+inline void sJSONClassifySSE2(const char *Block, sJSONBlockMasks &Masks) {
+    Masks = {0, 0, 0, 0, 0};
+    for (int Count = 0; Count < 4; ++Count) {
+        auto Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Block + Count * 16));
+        auto Lower = _mm_or_si128(Bytes, _mm_set1_epi8(0x20));
+        auto Quote = _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('"'));
+        auto Backslash = _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\\'));
+        auto Operator = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Lower, _mm_set1_epi8('{')),
+                                                  _mm_cmpeq_epi8(Lower, _mm_set1_epi8('}'))),
+                                     _mm_or_si128(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8(',')),
+                                                  _mm_cmpeq_epi8(Bytes, _mm_set1_epi8(':'))));
+        auto Space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8(' ')),
+                                               _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\t'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\n')),
+                                               _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\r'))));
+
+        int Shift = Count * 16;
+        Masks.Quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(Quote))) << Shift;
+        Masks.Backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(Backslash))) << Shift;
+        Masks.Operator |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(Operator))) << Shift;
+        Masks.Space |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(Space))) << Shift;
+        Masks.Newline |= static_cast<uint64_t>(
+                                 static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\n')))))
+                         << Shift;
+    }
+}
+
+sJSON_TARGET_AVX2 inline void sJSONClassifyAVX2(const char *Block, sJSONBlockMasks &Masks) {
+    Masks = {0, 0, 0, 0, 0};
+    for (int Count = 0; Count < 2; ++Count) {
+        auto Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Block + Count * 32));
+        auto Lower = _mm256_or_si256(Bytes, _mm256_set1_epi8(0x20));
+        auto Quote = _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('"'));
+        auto Backslash = _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\\'));
+        auto Operator = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Lower, _mm256_set1_epi8('{')),
+                                                        _mm256_cmpeq_epi8(Lower, _mm256_set1_epi8('}'))),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8(',')),
+                                                        _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8(':'))));
+        auto Space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8(' ')),
+                                                     _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\t'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\n')),
+                                                     _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\r'))));
+
+        int Shift = Count * 32;
+        Masks.Quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(Quote))) << Shift;
+        Masks.Backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(Backslash))) << Shift;
+        Masks.Operator |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(Operator))) << Shift;
+        Masks.Space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(Space))) << Shift;
+        Masks.Newline |= static_cast<uint64_t>(static_cast<uint32_t>(
+                                 _mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\n')))))
+                         << Shift;
+    }
+}
+#endif
+
+inline sJSONSIMDLevel sJSONDetectSIMDLevel() {
+#ifdef sJSON_X86_64
+    unsigned int Registers[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+    __cpuid(reinterpret_cast<int *>(Registers), 0);
+    unsigned int MaxLeaf = Registers[0];
+    __cpuid(reinterpret_cast<int *>(Registers), 1);
+#else
+    unsigned int MaxLeaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &Registers[0], &Registers[1], &Registers[2], &Registers[3]);
+#endif
+    bool OSXSave = (Registers[2] & (1u << 27)) != 0;
+    bool AVX = (Registers[2] & (1u << 28)) != 0;
+    if (MaxLeaf < 7 || !OSXSave || !AVX) {
+        return sJSONSIMDLevel::SSE2;
+    }
+
+#ifdef _MSC_VER
+    uint64_t EnabledState = _xgetbv(0);
+    __cpuidex(reinterpret_cast<int *>(Registers), 7, 0);
+#else
+    unsigned int EnabledLow, EnabledHigh;
+    __asm__("xgetbv" : "=a"(EnabledLow), "=d"(EnabledHigh) : "c"(0));
+    uint64_t EnabledState = (static_cast<uint64_t>(EnabledHigh) << 32) | EnabledLow;
+    __cpuid_count(7, 0, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+    if ((EnabledState & 0x6) == 0x6 && (Registers[1] & (1u << 5)) != 0) {
+        return sJSONSIMDLevel::AVX2;
+    }
+
+    return sJSONSIMDLevel::SSE2;
+#else
+    return sJSONSIMDLevel::Scalar;
+#endif
+}
+
+// Detected once at startup; every structural indexer uses it unless told otherwise.
+inline const sJSONSIMDLevel sJSONActiveSIMDLevel = sJSONDetectSIMDLevel();
+
+inline int sJSONCountTrailingZeros(uint64_t Bits) {
+#ifdef _MSC_VER
+    unsigned long Index;
+    _BitScanForward64(&Index, Bits);
+    return static_cast<int>(Index);
+#else
+    return __builtin_ctzll(Bits);
+#endif
+}
+
+inline int sJSONCountBits(uint64_t Bits) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(Bits));
+#else
+    return __builtin_popcountll(Bits);
+#endif
+}
+
+// Finds the offsets of every structural character ({ } [ ] , :), every opening quote and the first
+// character of every other scalar, 64 bytes at a time. The input is indexed one window at a time so
+// the index never grows with the size of the document.
+class sJSONStructuralIndexer {
+public:
+    static constexpr size_t WindowSize = 64 * 1024;
+
+public:
+    sJSONStructuralIndexer(std::string_view Code, sJSONSIMDLevel Level = sJSONActiveSIMDLevel)
+            : sJSON(Code), Position(0), PreviousEscaped(0), PreviousInString(0), PreviousScalar(0) {
+        switch (Level) {
+#ifdef sJSON_X86_64
+            case sJSONSIMDLevel::AVX2: {
+                Classify = sJSONClassifyAVX2;
+                break;
+            }
+            case sJSONSIMDLevel::SSE2: {
+                Classify = sJSONClassifySSE2;
+                break;
+            }
+#endif
+            default: {
+                Classify = sJSONClassifyScalar;
+                break;
+            }
+        }
+    }
+
+public:
+    // Replaces Positions with the structural offsets of the next window. Returns false once the whole
+    // input has been indexed.
+    bool Next(std::vector<size_t> &Positions) {
+        Positions.clear();
+        if (Position >= sJSON.size()) {
+            return false;
+        }
+
+        size_t End = Position + WindowSize < sJSON.size() ? Position + WindowSize : sJSON.size();
+        for (; Position + 64 <= End; Position += 64) {
+            IndexBlock(sJSON.data() + Position, Position, Positions);
+        }
+        if (Position < End) {
+            char Padding[64];
+            memset(Padding, ' ', sizeof(Padding));
+            memcpy(Padding, sJSON.data() + Position, End - Position);
+            IndexBlock(Padding, Position, Positions);
+            Position = End;
+        }
+
+        return true;
+    }
+
+    const bool InString() const {
+        return PreviousInString != 0;
+    }
+
+    // Starts over on a new input, keeping the selected classifier.
+    void Reset(std::string_view Code) {
+        sJSON = Code;
+        Position = 0;
+        PreviousEscaped = 0;
+        PreviousInString = 0;
+        PreviousScalar = 0;
+    }
+
+    // Indexes the input as the continuation of text that ended inside a string and/or with an
+    // unfinished escape, so that any slice of a document can be indexed on its own.
+    void Seed(bool InString, bool Escaped) {
+        PreviousInString = InString ? ~0ULL : 0;
+        PreviousEscaped = Escaped ? 1 : 0;
+    }
+
+    // Appends the structural offsets of one 64-byte block, numbered from Base, carrying the string and
+    // escape state over from the previous block. This lets input that arrives in pieces be indexed as
+    // it comes. Returns the number of line feeds in the block.
+    __forceinline int IndexBlock(const char *Block, size_t Base, std::vector<size_t> &Positions) {
+        sJSONBlockMasks Masks;
+        Classify(Block, Masks);
+
+        uint64_t Escaped = FindEscaped(Masks.Backslash);
+        uint64_t Quote = Masks.Quote & ~Escaped;
+        uint64_t InString = PrefixXor(Quote) ^ PreviousInString;
+        PreviousInString = static_cast<uint64_t>(static_cast<int64_t>(InString) >> 63);
+
+        uint64_t Scalar = ~(Masks.Operator | Masks.Space | Quote);
+        uint64_t FollowsScalar = (Scalar << 1) | PreviousScalar;
+        PreviousScalar = Scalar >> 63;
+
+        uint64_t Structural = ((Masks.Operator | (Scalar & ~FollowsScalar)) & ~InString) | (Quote & InString);
+        while (Structural != 0) {
+            Positions.push_back(Base + sJSONCountTrailingZeros(Structural));
+            Structural &= Structural - 1;
+        }
+
+        return sJSONCountBits(Masks.Newline);
+    }
+
+private:
+
+    __forceinline uint64_t FindEscaped(uint64_t Backslash) {
+        constexpr uint64_t EvenBits = 0x5555555555555555ULL;
+        if (Backslash == 0) {
+            uint64_t Escaped = PreviousEscaped;
+            PreviousEscaped = 0;
+            return Escaped;
+        }
+
+        Backslash &= ~PreviousEscaped;
+        uint64_t FollowsEscape = (Backslash << 1) | PreviousEscaped;
+        uint64_t OddSequenceStarts = Backslash & ~EvenBits & ~FollowsEscape;
+        uint64_t SequencesStartingOnEvenBits = OddSequenceStarts + Backslash;
+        PreviousEscaped = SequencesStartingOnEvenBits < OddSequenceStarts ? 1 : 0;
+        uint64_t InvertMask = SequencesStartingOnEvenBits << 1;
+
+        return (EvenBits ^ InvertMask) & FollowsEscape;
+    }
+
+    static __forceinline uint64_t PrefixXor(uint64_t Bits) {
+        Bits ^= Bits << 1;
+        Bits ^= Bits << 2;
+        Bits ^= Bits << 4;
+        Bits ^= Bits << 8;
+        Bits ^= Bits << 16;
+        Bits ^= Bits << 32;
+
+        return Bits;
+    }
+
+private:
+    std::string_view sJSON;
+    size_t Position;
+    uint64_t PreviousEscaped;
+    uint64_t PreviousInString;
+    uint64_t PreviousScalar;
+    void (*Classify)(const char *, sJSONBlockMasks &);
+};
+
+enum class sJSONNumberType {
+    Int,
+    Int64,
+    UInt64,
+    Double
+};
+
+// Integers that fit an int keep being reported as Int; wider ones become Int64/UInt64 and anything
+// else, including integers beyond 64 bits, becomes Double.
+struct sJSONNumber {
+    sJSONNumberType Type;
+    union {
+        int64_t Integer;
+        uint64_t Unsigned;
+        double Float;
+    };
+};
+
+inline bool sJSONIsDigit(char Character) {
+    return Character >= '0' && Character <= '9';
+}
+
+// Parses a JSON number (RFC 8259 grammar, the whole of Text). Doubles take Clinger's exact fast path
+// when the decimal significand fits in 53 bits and the power of ten is exactly representable, and
+// fall back to std::from_chars, whose Eisel-Lemire implementation rounds correctly, otherwise.
+inline bool sJSONParseNumber(std::string_view Text, sJSONNumber &Number) {
+    static constexpr double PowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                             1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                             1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char *Iterator = Text.data();
+    const char *End = Text.data() + Text.size();
+    bool Negative = Iterator != End && *Iterator == '-';
+    if (Negative) {
+        ++Iterator;
+    }
+    if (Iterator == End || !sJSONIsDigit(*Iterator)) {
+        return false;
+    }
+
+    uint64_t Significand = 0;
+    int Digits = 0;
+    int DroppedDigits = 0;
+    bool Overflow = false;
+    if (*Iterator == '0') {
+        ++Iterator;
+        if (Iterator != End && sJSONIsDigit(*Iterator)) {
+            return false;
+        }
+    } else {
+        for (; Iterator != End && sJSONIsDigit(*Iterator); ++Iterator) {
+            uint64_t Digit = static_cast<uint64_t>(*Iterator - '0');
+            if (Significand > (std::numeric_limits<uint64_t>::max() - Digit) / 10) {
+                Overflow = true;
+                ++DroppedDigits;
+            } else if (!Overflow) {
+                Significand = Significand * 10 + Digit;
+                ++Digits;
+            } else {
+                ++DroppedDigits;
+            }
+        }
+    }
+
+    int Exponent = DroppedDigits;
+    bool Integral = true;
+    if (Iterator != End && *Iterator == '.') {
+        Integral = false;
+        ++Iterator;
+        if (Iterator == End || !sJSONIsDigit(*Iterator)) {
+            return false;
+        }
+        for (; Iterator != End && sJSONIsDigit(*Iterator); ++Iterator) {
+            if (Digits < 19) {
+                Significand = Significand * 10 + static_cast<uint64_t>(*Iterator - '0');
+                if (Significand != 0) {
+                    ++Digits;
+                }
+                --Exponent;
+            } else {
+                Overflow = true;
+            }
+        }
+    }
+    if (Iterator != End && (*Iterator == 'e' || *Iterator == 'E')) {
+        Integral = false;
+        ++Iterator;
+        bool NegativeExponent = Iterator != End && *Iterator == '-';
+        if (Iterator != End && (*Iterator == '-' || *Iterator == '+')) {
+            ++Iterator;
+        }
+        if (Iterator == End || !sJSONIsDigit(*Iterator)) {
+            return false;
+        }
+
+        int Explicit = 0;
+        for (; Iterator != End && sJSONIsDigit(*Iterator); ++Iterator) {
+            if (Explicit < 100000) {
+                Explicit = Explicit * 10 + (*Iterator - '0');
+            }
+        }
+        Exponent += NegativeExponent ? -Explicit : Explicit;
+    }
+    if (Iterator != End) {
+        return false;
+    }
+
+    if (Integral && !Overflow) {
+        if (!Negative) {
+            if (Significand <= static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+                Number.Type = sJSONNumberType::Int;
+                Number.Integer = static_cast<int64_t>(Significand);
+            } else if (Significand <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                Number.Type = sJSONNumberType::Int64;
+                Number.Integer = static_cast<int64_t>(Significand);
+            } else {
+                Number.Type = sJSONNumberType::UInt64;
+                Number.Unsigned = Significand;
+            }
+
+            return true;
+        }
+        if (Significand <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1) {
+            Number.Integer = static_cast<int64_t>(0 - Significand);
+            Number.Type = Number.Integer >= std::numeric_limits<int>::min() ? sJSONNumberType::Int
+                                                                             : sJSONNumberType::Int64;
+            return true;
+        }
+    }
+
+    Number.Type = sJSONNumberType::Double;
+    if (!Overflow && Significand <= (uint64_t(1) << 53) && Exponent >= -22 && Exponent <= 22) {
+        double Value = static_cast<double>(Significand);
+        Value = Exponent < 0 ? Value / PowersOfTen[-Exponent] : Value * PowersOfTen[Exponent];
+        Number.Float = Negative ? -Value : Value;
+        return true;
+    }
+
+    double Value = 0;
+    auto Result = std::from_chars(Text.data(), End, Value);
+    if (Result.ec == std::errc::result_out_of_range) {
+        if (Exponent > 0) {
+            return false;
+        }
+
+        Value = Negative ? -0.0 : 0.0;
+    } else if (Result.ec != std::errc() || Result.ptr != End) {
+        return false;
+    }
+
+    Number.Float = Value;
+    return true;
+}
+
+// Writes the shortest text that reads back as exactly Value. Buffer must hold 32 characters. A
+// trailing ".0" keeps integral doubles from turning into integers on the next parse, and values JSON
+// cannot express are written as null. Floats get their own shortest form rather than that of the double
+// they widen to.
+template<class Float>
+inline char *sJSONFormatFloat(char *Buffer, Float Value) {
+    if (!std::isfinite(Value)) {
+        memcpy(Buffer, "null", 4);
+        return Buffer + 4;
+    }
+
+    auto End = std::to_chars(Buffer, Buffer + 32, Value).ptr;
+    for (auto Iterator = Buffer; Iterator != End; ++Iterator) {
+        if (*Iterator == '.' || *Iterator == 'e') {
+            return End;
+        }
+    }
+
+    End[0] = '.';
+    End[1] = '0';
+    return End + 2;
+}
+
+inline char *sJSONFormatNumber(char *Buffer, double Value) {
+    return sJSONFormatFloat(Buffer, Value);
+}
+
+inline char *sJSONFormatNumber(char *Buffer, float Value) {
+    return sJSONFormatFloat(Buffer, Value);
+}
+
+template<class Integer>
+inline char *sJSONFormatNumber(char *Buffer, Integer Value) {
+    return std::to_chars(Buffer, Buffer + 32, Value).ptr;
+}
+
+// Strings are scanned 32 or 16 bytes at a time for the characters that need attention (quotes,
+// backslashes and control characters); the plain runs between them are copied in bulk.
+inline const char *sJSONScanStringScalar(const char *Begin, const char *End) {
+    for (; Begin != End; ++Begin) {
+        auto Character = static_cast<unsigned char>(*Begin);
+        if (Character == '\"' || Character == '\\' || Character < 0x20) {
+            return Begin;
+        }
+    }
+
+    return End;
+}
+
+#ifdef sJSON_X86_64
+inline const char *sJSONScanStringSSE2(const char *Begin, const char *End) {
+    for (; End - Begin >= 16; Begin += 16) {
+        auto Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Begin));
+        auto Control = _mm_cmpeq_epi8(_mm_min_epu8(Bytes, _mm_set1_epi8(0x1F)), Bytes);
+        auto Special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\"')),
+                                                 _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\\'))),
+                                    Control);
+        int Mask = _mm_movemask_epi8(Special);
+        if (Mask != 0) {
+            return Begin + sJSONCountTrailingZeros(static_cast<uint64_t>(Mask));
+        }
+    }
+
+    return sJSONScanStringScalar(Begin, End);
+}
+
+sJSON_TARGET_AVX2 inline const char *sJSONScanStringAVX2(const char *Begin, const char *End) {
+    for (; End - Begin >= 32; Begin += 32) {
+        auto Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Begin));
+        auto Control = _mm256_cmpeq_epi8(_mm256_min_epu8(Bytes, _mm256_set1_epi8(0x1F)), Bytes);
+        auto Special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\"')),
+                                                       _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\\'))),
+                                       Control);
+        auto Mask = static_cast<uint32_t>(_mm256_movemask_epi8(Special));
+        if (Mask != 0) {
+            return Begin + sJSONCountTrailingZeros(Mask);
+        }
+    }
+
+    return sJSONScanStringSSE2(Begin, End);
+}
+#endif
+
+// First quote, backslash or control character in [Begin, End), or End.
+inline const char *sJSONScanString(const char *Begin, const char *End) {
+#ifdef sJSON_X86_64
+    if (sJSONActiveSIMDLevel == sJSONSIMDLevel::AVX2) {
+        return sJSONScanStringAVX2(Begin, End);
+    }
+    return sJSONScanStringSSE2(Begin, End);
+#else
+    return sJSONScanStringScalar(Begin, End);
+#endif
+}
+
+inline constexpr size_t sJSONBadString = std::numeric_limits<size_t>::max();
+
+inline bool sJSONReadHex4(const char *Text, uint32_t &Value) {
+    Value = 0;
+    for (int Count = 0; Count < 4; ++Count) {
+        char Character = Text[Count];
+        uint32_t Digit;
+        if (Character >= '0' && Character <= '9') {
+            Digit = Character - '0';
+        } else if (Character >= 'a' && Character <= 'f') {
+            Digit = Character - 'a' + 10;
+        } else if (Character >= 'A' && Character <= 'F') {
+            Digit = Character - 'A' + 10;
+        } else {
+            return false;
+        }
+        Value = Value << 4 | Digit;
+    }
+
+    return true;
+}
+
+inline char *sJSONEncodeUTF8(uint32_t CodePoint, char *Output) {
+    if (CodePoint < 0x80) {
+        *Output++ = static_cast<char>(CodePoint);
+    } else if (CodePoint < 0x800) {
+        *Output++ = static_cast<char>(0xC0 | (CodePoint >> 6));
+        *Output++ = static_cast<char>(0x80 | (CodePoint & 0x3F));
+    } else if (CodePoint < 0x10000) {
+        *Output++ = static_cast<char>(0xE0 | (CodePoint >> 12));
+        *Output++ = static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F));
+        *Output++ = static_cast<char>(0x80 | (CodePoint & 0x3F));
+    } else {
+        *Output++ = static_cast<char>(0xF0 | (CodePoint >> 18));
+        *Output++ = static_cast<char>(0x80 | ((CodePoint >> 12) & 0x3F));
+        *Output++ = static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F));
+        *Output++ = static_cast<char>(0x80 | (CodePoint & 0x3F));
+    }
+
+    return Output;
+}
+
+// Decodes the escape sequences of a raw string token into Output, which must hold at least
+// Raw.size() characters: no escape is shorter than what it stands for. \uXXXX escapes become UTF-8,
+// surrogate pairs included. Returns the decoded length, or sJSONBadString for an unknown escape,
+// a malformed \u escape or an unpaired surrogate.
+inline size_t sJSONDecodeString(std::string_view Raw, char *Output) {
+    const char *Iterator = Raw.data();
+    const char *End = Raw.data() + Raw.size();
+    char *Target = Output;
+    while (true) {
+        const char *Stop = sJSONScanString(Iterator, End);
+        memcpy(Target, Iterator, Stop - Iterator);
+        Target += Stop - Iterator;
+        if (Stop == End) {
+            break;
+        }
+        if (*Stop != '\\') {
+            *Target++ = *Stop;
+            Iterator = Stop + 1;
+            continue;
+        }
+        if (Stop + 1 == End) {
+            return sJSONBadString;
+        }
+
+        Iterator = Stop + 2;
+        switch (Stop[1]) {
+            case '\"':
+            case '\\':
+            case '/': {
+                *Target++ = Stop[1];
+                break;
+            }
+            case 'b': {
+                *Target++ = '\b';
+                break;
+            }
+            case 'f': {
+                *Target++ = '\f';
+                break;
+            }
+            case 'n': {
+                *Target++ = '\n';
+                break;
+            }
+            case 'r': {
+                *Target++ = '\r';
+                break;
+            }
+            case 't': {
+                *Target++ = '\t';
+                break;
+            }
+            case 'u': {
+                uint32_t CodePoint;
+                if (End - Iterator < 4 || !sJSONReadHex4(Iterator, CodePoint)) {
+                    return sJSONBadString;
+                }
+                Iterator += 4;
+
+                if (CodePoint >= 0xD800 && CodePoint <= 0xDBFF) {
+                    uint32_t Low;
+                    if (End - Iterator < 6 || Iterator[0] != '\\' || Iterator[1] != 'u' ||
+                        !sJSONReadHex4(Iterator + 2, Low) || Low < 0xDC00 || Low > 0xDFFF) {
+                        return sJSONBadString;
+                    }
+                    Iterator += 6;
+                    CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+                } else if (CodePoint >= 0xDC00 && CodePoint <= 0xDFFF) {
+                    return sJSONBadString;
+                }
+                Target = sJSONEncodeUTF8(CodePoint, Target);
+                break;
+            }
+            default: {
+                return sJSONBadString;
+            }
+        }
+    }
+
+    return Target - Output;
+}
+
+// Writes Text as the inside of a JSON string: quotes, backslashes and control characters are escaped,
+// everything else, UTF-8 included, is copied as it is.
+template<class Sink>
+inline void sJSONWriteEscaped(Sink &Output, std::string_view Text) {
+    static constexpr char Hex[] = "0123456789abcdef";
+    const char *Iterator = Text.data();
+    const char *End = Text.data() + Text.size();
+    while (true) {
+        const char *Stop = sJSONScanString(Iterator, End);
+        if (Stop != Iterator) {
+            Output.Write(Iterator, Stop - Iterator);
+        }
+        if (Stop == End) {
+            return;
+        }
+
+        char Escape[6] = {'\\', *Stop, '0', '0', '0', '0'};
+        size_t Size = 2;
+        switch (*Stop) {
+            case '\b': {
+                Escape[1] = 'b';
+                break;
+            }
+            case '\f': {
+                Escape[1] = 'f';
+                break;
+            }
+            case '\n': {
+                Escape[1] = 'n';
+                break;
+            }
+            case '\r': {
+                Escape[1] = 'r';
+                break;
+            }
+            case '\t': {
+                Escape[1] = 't';
+                break;
+            }
+            case '\"':
+            case '\\': {
+                break;
+            }
+            default: {
+                Escape[1] = 'u';
+                Escape[4] = Hex[static_cast<unsigned char>(*Stop) >> 4];
+                Escape[5] = Hex[*Stop & 0xF];
+                Size = 6;
+                break;
+            }
+        }
+        Output.Write(Escape, Size);
+        Iterator = Stop + 1;
+    }
+}
+
+// Offset of the first byte that does not start a valid sequence. Overlong forms, surrogates and code
+// points past U+10FFFF are invalid.
+inline size_t sJSONFindInvalidUTF8Scalar(const char *Data, size_t Size) {
+    auto Bytes = reinterpret_cast<const unsigned char *>(Data);
+    size_t Position = 0;
+    while (Position < Size) {
+        uint64_t Word;
+        if (Position + 8 <= Size && (memcpy(&Word, Bytes + Position, 8), (Word & 0x8080808080808080ULL) == 0)) {
+            Position += 8;
+            continue;
+        }
+
+        unsigned char Lead = Bytes[Position];
+        if (Lead < 0x80) {
+            ++Position;
+            continue;
+        }
+
+        size_t Length;
+        uint32_t CodePoint;
+        if ((Lead & 0xE0) == 0xC0) {
+            Length = 2;
+            CodePoint = Lead & 0x1F;
+        } else if ((Lead & 0xF0) == 0xE0) {
+            Length = 3;
+            CodePoint = Lead & 0x0F;
+        } else if ((Lead & 0xF8) == 0xF0) {
+            Length = 4;
+            CodePoint = Lead & 0x07;
+        } else {
+            return Position;
+        }
+        if (Size - Position < Length) {
+            return Position;
+        }
+        for (size_t Count = 1; Count < Length; ++Count) {
+            if ((Bytes[Position + Count] & 0xC0) != 0x80) {
+                return Position;
+            }
+            CodePoint = CodePoint << 6 | (Bytes[Position + Count] & 0x3F);
+        }
+
+        static constexpr uint32_t Smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (CodePoint < Smallest[Length] || CodePoint > 0x10FFFF || (CodePoint >= 0xD800 && CodePoint <= 0xDFFF)) {
+            return Position;
+        }
+        Position += Length;
+    }
+
+    return Size;
+}
+
+#ifdef sJSON_X86_64
+// The lookup validator of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction Per
+// Byte"): every byte is classified together with the one before it by three table lookups, whose
+// common bits are the errors, and the bytes that must continue a three or four byte sequence are
+// checked apart.
+struct sJSONUTF8Tables {
+    static constexpr int8_t TooShort = 1 << 0;
+    static constexpr int8_t TooLong = 1 << 1;
+    static constexpr int8_t Overlong3 = 1 << 2;
+    static constexpr int8_t TooLarge = 1 << 3;
+    static constexpr int8_t Surrogate = 1 << 4;
+    static constexpr int8_t Overlong2 = 1 << 5;
+    static constexpr int8_t TooLarge1000 = 1 << 6;
+    static constexpr int8_t Overlong4 = 1 << 6;
+    static constexpr int8_t TwoContinuations = -128;
+    static constexpr int8_t Carry = TooShort | TooLong | TwoContinuations;
+
+    static constexpr int8_t FirstHigh[16] = {
+            TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+            TwoContinuations, TwoContinuations, TwoContinuations, TwoContinuations,
+            TooShort | Overlong2, TooShort, TooShort | Overlong3 | Surrogate,
+            TooShort | TooLarge | TooLarge1000 | Overlong4};
+    static constexpr int8_t FirstLow[16] = {
+            Carry | Overlong3 | Overlong2 | Overlong4, Carry | Overlong2, Carry, Carry, Carry | TooLarge,
+            Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000 | Surrogate, Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000};
+    static constexpr int8_t SecondHigh[16] = {
+            TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+            TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge1000 | Overlong4,
+            TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge,
+            TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+            TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+            TooShort, TooShort, TooShort, TooShort};
+};
+
+// Input shifted right by Count bytes, with the last bytes of Previous shifted in.
+template<int Count>
+sJSON_TARGET_AVX2 inline __m256i sJSONShiftInAVX2(__m256i Input, __m256i Previous) {
+    return _mm256_alignr_epi8(Input, _mm256_permute2x128_si256(Previous, Input, 0x21), 16 - Count);
+}
+
+sJSON_TARGET_AVX2 inline __m256i sJSONLoadTableAVX2(const int8_t *Entries) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Entries)));
+}
+
+sJSON_TARGET_AVX2 inline __m256i sJSONCheckUTF8AVX2(__m256i Input, __m256i Previous) {
+    auto Nibbles = _mm256_set1_epi8(0x0F);
+    auto Previous1 = sJSONShiftInAVX2<1>(Input, Previous);
+    auto FirstHigh = _mm256_shuffle_epi8(sJSONLoadTableAVX2(sJSONUTF8Tables::FirstHigh),
+                                         _mm256_and_si256(_mm256_srli_epi16(Previous1, 4), Nibbles));
+    auto FirstLow =
+            _mm256_shuffle_epi8(sJSONLoadTableAVX2(sJSONUTF8Tables::FirstLow), _mm256_and_si256(Previous1, Nibbles));
+    auto SecondHigh = _mm256_shuffle_epi8(sJSONLoadTableAVX2(sJSONUTF8Tables::SecondHigh),
+                                          _mm256_and_si256(_mm256_srli_epi16(Input, 4), Nibbles));
+    auto Special = _mm256_and_si256(_mm256_and_si256(FirstHigh, FirstLow), SecondHigh);
+
+    auto Third = _mm256_subs_epu8(sJSONShiftInAVX2<2>(Input, Previous), _mm256_set1_epi8(0xE0 - 0x80));
+    auto Fourth = _mm256_subs_epu8(sJSONShiftInAVX2<3>(Input, Previous), _mm256_set1_epi8(0xF0 - 0x80));
+    auto Continuation = _mm256_and_si256(_mm256_or_si256(Third, Fourth), _mm256_set1_epi8(-128));
+
+    return _mm256_xor_si256(Continuation, Special);
+}
+
+sJSON_TARGET_AVX2 inline bool sJSONIsValidUTF8AVX2(const char *Data, size_t Size) {
+    // A sequence may not start in the last three bytes of a block if it does not fit.
+    auto Last = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                 -1, -1, -1, -1, -1, -1, -1, -1, static_cast<char>(0xF0 - 1),
+                                 static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    auto Error = _mm256_setzero_si256();
+    auto Previous = _mm256_setzero_si256();
+    auto Incomplete = _mm256_setzero_si256();
+    char Padding[32] = {};
+    for (size_t Position = 0; Position < Size; Position += 32) {
+        const char *Block = Data + Position;
+        if (Size - Position < 32) {
+            memcpy(Padding, Block, Size - Position);
+            Block = Padding;
+        }
+
+        auto Input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Block));
+        if (_mm256_movemask_epi8(Input) == 0) {
+            Error = _mm256_or_si256(Error, Incomplete);
+            Incomplete = _mm256_setzero_si256();
+        } else {
+            Error = _mm256_or_si256(Error, sJSONCheckUTF8AVX2(Input, Previous));
+            Incomplete = _mm256_subs_epu8(Input, Last);
+        }
+        Previous = Input;
+    }
+
+    Error = _mm256_or_si256(Error, Incomplete);
+    return _mm256_testz_si256(Error, Error) != 0;
+}
+#endif
+
+// Offset of the first byte of Text that is not valid UTF-8, or Text.size() when all of it is.
+inline size_t sJSONFindInvalidUTF8(std::string_view Text) {
+#ifdef sJSON_X86_64
+    if (sJSONActiveSIMDLevel == sJSONSIMDLevel::AVX2 && sJSONIsValidUTF8AVX2(Text.data(), Text.size())) {
+        return Text.size();
+    }
+#endif
+    return sJSONFindInvalidUTF8Scalar(Text.data(), Text.size());
+}
+
+struct sJSONToken {
+    size_t Offset;
+    size_t Length;
+    sJSONTokenType Type;
+    bool Escaped;
+};
+
+// Splits a JSON text into (offset, length, type) slices without copying it. For string tokens the
+// slice covers the characters between the quotes and Escaped tells whether it has to be decoded.
+class sJSONLexer {
+public:
+    sJSONLexer(std::string_view Code, sJSONParserStatus *Status, sJSONSIMDLevel Level = sJSONActiveSIMDLevel)
+            : ParserStatus(Status), sJSON(Code), Position(0), Indexer(Code, Level), Cursor(0), ScanSeconds(nullptr) {
+        constexpr size_t WindowSize = sJSONStructuralIndexer::WindowSize;
+        Positions.reserve((Code.size() < WindowSize ? Code.size() : WindowSize) / 4 + 16);
+    }
+
+public:
+    // Starts over on a new input. The position buffer is kept, so a lexer reused across many small
+    // inputs does not allocate once it has warmed up.
+    void Reset(std::string_view Code) {
+        sJSON = Code;
+        Position = 0;
+        Indexer.Reset(Code);
+        Positions.clear();
+        Cursor = 0;
+    }
+
+    inline sJSONToken operator()() {
+        while (Cursor < Positions.size() && Positions[Cursor] < Position) {
+            ++Cursor;
+        }
+        while (Cursor == Positions.size()) {
+            Cursor = 0;
+            if (!NextWindow()) {
+                Position = sJSON.size();
+                return {Position, 0, sJSONTokenType::End, false};
+            }
+        }
+
+        size_t Next = Positions[Cursor++];
+        if (Position < Next && !IsSpace(sJSON[Position])) {
+            size_t Begin = Position;
+            Position = Next;
+            return {Begin, Next - Begin, sJSONTokenType::Unknown, false};
+        }
+        Position = Next;
+        if (sJSON[Position] == '\0') {
+            return {Position, 0, sJSONTokenType::End, false};
+        }
+
+        size_t Begin = Position;
+        char Character = sJSON[Position];
+        switch (Character) {
+            case '{': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::BigLeft, false};
+            }
+            case '}': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::BigRight, false};
+            }
+            case '[': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::MiddleLeft, false};
+            }
+            case ']': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::MiddleRight, false};
+            }
+            case ',': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::Comma, false};
+            }
+            case ':': {
+                ++Position;
+                return {Begin, 1, sJSONTokenType::Colon, false};
+            }
+            case '\"': {
+                return LexString();
+            }
+            default: {
+                break;
+            }
+        }
+
+        if ((Character >= '0' && Character <= '9') || Character == '-') {
+            return LexNumber();
+        }
+        if ((Character >= 'a' && Character <= 'z') || (Character >= 'A' && Character <= 'Z') || Character == '_') {
+            while (Position < sJSON.size() && IsWordCharacter(sJSON[Position])) {
+                ++Position;
+            }
+
+            auto Word = sJSON.substr(Begin, Position - Begin);
+            if (Word == "true" || Word == "false") {
+                return {Begin, Word.size(), sJSONTokenType::Boolean, false};
+            }
+            if (Word == "null") {
+                return {Begin, Word.size(), sJSONTokenType::Null, false};
+            }
+
+            return {Begin, Word.size(), sJSONTokenType::Unknown, false};
+        }
+
+        ++Position;
+        return {Begin, 1, sJSONTokenType::Unknown, false};
+    }
+
+    std::string_view GetText(const sJSONToken &Token) const {
+        return sJSON.substr(Token.Offset, Token.Length);
+    }
+
+    // Adds the time spent scanning for structural characters to *Seconds, or stops when it is nullptr.
+    void SetScanTimer(double *Seconds) {
+        ScanSeconds = Seconds;
+    }
+
+    bool operator*() {
+        return Position < sJSON.size();
+    }
+
+    const size_t GetPosition() const {
+        return Position;
+    }
+
+    const size_t GetLine() const {
+        size_t Line = 1;
+        for (size_t Count = 0; Count < Position; ++Count) {
+            if (sJSON[Count] == '\n') {
+                ++Line;
+            }
+        }
+
+        return Line;
+    }
+
+private:
+    static __forceinline bool IsSpace(char Character) {
+        return Character == ' ' || Character == '\t' || Character == '\n' || Character == '\r';
+    }
+
+    static __forceinline bool IsWordCharacter(char Character) {
+        return (Character >= 'a' && Character <= 'z') || (Character >= 'A' && Character <= 'Z') ||
+               (Character >= '0' && Character <= '9') || Character == '_';
+    }
+
+    bool NextWindow() {
+        if (ScanSeconds == nullptr) {
+            return Indexer.Next(Positions);
+        }
+
+        auto Start = std::chrono::steady_clock::now();
+        bool Found = Indexer.Next(Positions);
+        *ScanSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        return Found;
+    }
+
+    sJSONToken LexString() {
+        size_t Begin = ++Position;
+        bool Escaped = false;
+        while (Position < sJSON.size()) {
+            Position = sJSONScanString(sJSON.data() + Position, sJSON.data() + sJSON.size()) - sJSON.data();
+            if (Position == sJSON.size()) {
+                break;
+            }
+
+            char Character = sJSON[Position];
+            if (Character == '\"') {
+                ++Position;
+                return {Begin, Position - Begin - 1, sJSONTokenType::string, Escaped};
+            }
+            if (Character == '\\') {
+                Escaped = true;
+                ++Position;
+            }
+
+            ++Position;
+        }
+
+        ParserStatus->ErrorInfo.push_back("Not match \" of the begin of \"");
+        return {Begin, 0, sJSONTokenType::Unknown, false};
+    }
+
+    // Only delimits the number; sJSONParseNumber checks the grammar when the value is read.
+    sJSONToken LexNumber() {
+        size_t Begin = Position;
+        bool Float = false;
+        while (Position < sJSON.size()) {
+            char Character = sJSON[Position];
+            if (Character == '.' || Character == 'e' || Character == 'E') {
+                Float = true;
+            } else if ((Character < '0' || Character > '9') && Character != '-' && Character != '+') {
+                break;
+            }
+
+            ++Position;
+        }
+
+        return {Begin, Position - Begin, Float ? sJSONTokenType::Float : sJSONTokenType::Number, false};
+    }
+
+private:
+    sJSONParserStatus *ParserStatus;
+    std::string_view sJSON;
+    size_t Position;
+    sJSONStructuralIndexer Indexer;
+    std::vector<size_t> Positions;
+    size_t Cursor;
+    double *ScanSeconds;
+};
+
+// Read-only memory mapping of a whole file, so that it can be handed to sJSONParser in
+// sJSONInputMode::Reference without being read into memory first.
+class sJSONMappedFile {
+public:
+    sJSONMappedFile(const std::string &Path) : Data(nullptr), Size(0), Opened(false) {
+#ifdef _WIN32
+        FileHandle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL, nullptr);
+        MappingHandle = nullptr;
+        if (FileHandle == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER FileSize;
+        if (!GetFileSizeEx(FileHandle, &FileSize)) {
+            return;
+        }
+        Size = static_cast<size_t>(FileSize.QuadPart);
+        Opened = true;
+        if (Size == 0) {
+            return;
+        }
+
+        MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (MappingHandle == nullptr) {
+            Opened = false;
+            return;
+        }
+        Data = static_cast<const char *>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        Opened = Data != nullptr;
+#else
+        FileDescriptor = open(Path.c_str(), O_RDONLY);
+        if (FileDescriptor < 0) {
+            return;
+        }
+
+        struct stat FileStatus;
+        if (fstat(FileDescriptor, &FileStatus) != 0) {
+            return;
+        }
+        Size = static_cast<size_t>(FileStatus.st_size);
+        Opened = true;
+        if (Size == 0) {
+            return;
+        }
+
+        auto Mapping = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+        if (Mapping == MAP_FAILED) {
+            Opened = false;
+            return;
+        }
+        Data = static_cast<const char *>(Mapping);
+        madvise(Mapping, Size, MADV_SEQUENTIAL);
+#endif
+    }
+
+    sJSONMappedFile(const sJSONMappedFile &) = delete;
+
+    sJSONMappedFile &operator=(const sJSONMappedFile &) = delete;
+
+    ~sJSONMappedFile() {
+#ifdef _WIN32
+        if (Data != nullptr) {
+            UnmapViewOfFile(Data);
+        }
+        if (MappingHandle != nullptr) {
+            CloseHandle(MappingHandle);
+        }
+        if (FileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(FileHandle);
+        }
+#else
+        if (Data != nullptr) {
+            munmap(const_cast<char *>(Data), Size);
+        }
+        if (FileDescriptor >= 0) {
+            close(FileDescriptor);
+        }
+#endif
+    }
+
+public:
+    const bool IsOpen() const {
+        return Opened;
+    }
+
+    std::string_view GetView() const {
+        if (Data == nullptr) {
+            return std::string_view();
+        }
+
+        return std::string_view(Data, Size);
+    }
+
+private:
+    const char *Data;
+    size_t Size;
+    bool Opened;
+#ifdef _WIN32
+    HANDLE FileHandle;
+    HANDLE MappingHandle;
+#else
+    int FileDescriptor;
+#endif
+};
+
+class sJSONLazyValue;
+
+// Input of an on-demand parse. Nothing is parsed up front: values found through sJSONLazyValue scan the
+// text forward from their own offset and step over everything they are not asked for, so untouched
+// parts of the document are neither decoded nor validated.
+class sJSONLazyDocument {
+public:
+    static constexpr size_t NotFound = std::string_view::npos;
+
+public:
+    // Code is not copied and has to outlive the document and every value taken from it.
+    explicit sJSONLazyDocument(std::string_view Code) : Code(Code) {
+    }
+
+    sJSONLazyDocument(const sJSONLazyDocument &) = delete;
+
+    sJSONLazyDocument &operator=(const sJSONLazyDocument &) = delete;
+
+public:
+    sJSONLazyValue GetRoot();
+
+    sJSONLazyValue operator[](std::string_view Key);
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+    std::string_view GetCode() const {
+        return Code;
+    }
+
+    size_t SkipSpace(size_t Position) const {
+        while (Position < Code.size() && IsSpace(Code[Position])) {
+            ++Position;
+        }
+
+        return Position;
+    }
+
+    // Returns the offset just past the string whose opening quote is at Position.
+    size_t SkipString(size_t Position) {
+        const char *Data = Code.data();
+        ++Position;
+        while (Position < Code.size()) {
+            auto Quote = static_cast<const char *>(memchr(Data + Position, '\"', Code.size() - Position));
+            if (Quote == nullptr) {
+                break;
+            }
+
+            size_t End = Quote - Data;
+            size_t Backslashes = 0;
+            while (Data[End - Backslashes - 1] == '\\') {
+                ++Backslashes;
+            }
+            if (Backslashes % 2 == 0) {
+                return End + 1;
+            }
+            Position = End + 1;
+        }
+
+        return PushError(Code.size());
+    }
+
+    // Returns the offset just past the value starting at Position by matching brackets and quotes.
+    size_t SkipValue(size_t Position) {
+        if (Position >= Code.size()) {
+            return PushError(Position);
+        }
+
+        char Character = Code[Position];
+        if (Character == '\"') {
+            return SkipString(Position);
+        }
+        if (Character != '{' && Character != '[') {
+            size_t Begin = Position;
+            while (Position < Code.size() && !IsDelimiter(Code[Position])) {
+                ++Position;
+            }
+
+            return Position == Begin ? PushError(Begin) : Position;
+        }
+
+        size_t Depth = 0;
+        do {
+            switch (Code[Position]) {
+                case '\"': {
+                    Position = SkipString(Position);
+                    if (Position == NotFound) {
+                        return NotFound;
+                    }
+                    continue;
+                }
+                case '{':
+                case '[': {
+                    ++Depth;
+                    break;
+                }
+                case '}':
+                case ']': {
+                    --Depth;
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+            ++Position;
+        } while (Depth != 0 && Position < Code.size());
+
+        return Depth == 0 ? Position : PushError(Position);
+    }
+
+    // Reads the entry of a container at Position: for objects the key and the colon, after which Value
+    // holds the offset of the member's value. Returns false on malformed input.
+    bool ReadEntry(size_t Position, bool IsObject, std::string_view &Key, size_t &Value) {
+        if (!IsObject) {
+            Key = std::string_view();
+            Value = Position;
+            return true;
+        }
+        if (Position >= Code.size() || Code[Position] != '\"') {
+            PushError(Position);
+            return false;
+        }
+
+        size_t End = SkipString(Position);
+        if (End == NotFound) {
+            return false;
+        }
+        Key = Code.substr(Position + 1, End - Position - 2);
+
+        End = SkipSpace(End);
+        if (End >= Code.size() || Code[End] != ':') {
+            PushError(End);
+            return false;
+        }
+        Value = SkipSpace(End + 1);
+
+        return true;
+    }
+
+    // Given the offset of an entry's value, returns the offset of the next entry, or NotFound at the
+    // end of the container or on error.
+    size_t NextEntry(size_t Value, char Closer) {
+        size_t Position = SkipValue(Value);
+        if (Position == NotFound) {
+            return NotFound;
+        }
+
+        return EntryAfter(Position, Closer);
+    }
+
+    // Same as NextEntry, given the offset just past the entry's value.
+    size_t EntryAfter(size_t Position, char Closer) {
+        Position = SkipSpace(Position);
+        if (Position < Code.size() && Code[Position] == ',') {
+            return SkipSpace(Position + 1);
+        }
+        if (Position >= Code.size() || Code[Position] != Closer) {
+            PushError(Position);
+        }
+
+        return NotFound;
+    }
+
+    // Offset of the first entry of the container opening at Position, or NotFound when it is empty.
+    size_t FirstEntry(size_t Position, char Closer) {
+        Position = SkipSpace(Position + 1);
+        if (Position < Code.size() && Code[Position] == Closer) {
+            return NotFound;
+        }
+        if (Position >= Code.size()) {
+            PushError(Position);
+            return NotFound;
+        }
+
+        return Position;
+    }
+
+    // Decodes a raw string if it has escapes. The copy lives as long as the document; a bad escape
+    // records an error and decodes to an empty string.
+    std::string_view DecodeString(std::string_view Raw) {
+        if (Raw.find('\\') == std::string_view::npos) {
+            return Raw;
+        }
+
+        auto Buffer = static_cast<char *>(Arena.Allocate(Raw.size() + 1, 1));
+        size_t Size = sJSONDecodeString(Raw, Buffer);
+        if (Size == sJSONBadString) {
+            if (!Status.ExsitsError()) {
+                Status.ErrorInfo.push_back("<Bad string>");
+            }
+            return std::string_view();
+        }
+
+        return std::string_view(Buffer, Size);
+    }
+
+    // Compares an escaped raw key with Key, decoding short keys on the stack.
+    bool DecodedEquals(std::string_view Raw, std::string_view Key) {
+        if (Raw.size() < Key.size()) {
+            return false;
+        }
+        if (Raw.size() > 256) {
+            return DecodeString(Raw) == Key;
+        }
+
+        char Buffer[256];
+        size_t Size = sJSONDecodeString(Raw, Buffer);
+        return Size != sJSONBadString && std::string_view(Buffer, Size) == Key;
+    }
+
+    // Records malformed input at Position and returns NotFound.
+    size_t PushError(size_t Position) {
+        if (Status.ExsitsError()) {
+            return NotFound;
+        }
+        if (Position >= Code.size()) {
+            Status.ErrorInfo.push_back("<Bad sJSON tree>");
+            return NotFound;
+        }
+
+        size_t Line = 1;
+        for (size_t Count = 0; Count < Position; ++Count) {
+            if (Code[Count] == '\n') {
+                ++Line;
+            }
+        }
+        Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Line) + ".");
+
+        return NotFound;
+    }
+
+private:
+    static __forceinline bool IsSpace(char Character) {
+        return Character == ' ' || Character == '\t' || Character == '\n' || Character == '\r';
+    }
+
+    static __forceinline bool IsDelimiter(char Character) {
+        return IsSpace(Character) || Character == ',' || Character == '}' || Character == ']' || Character == ':';
+    }
+
+private:
+    std::string_view Code;
+    sJSONArena Arena;
+    sJSONParserStatus Status;
+};
+
+class sJSONLazyIterator;
+
+// Handle to a value inside an sJSONLazyDocument: just the document and the offset of the value. An
+// empty handle stands for a member or element that does not exist.
+class sJSONLazyValue {
+public:
+    sJSONLazyValue() : Document(nullptr), Offset(0) {
+    }
+
+    sJSONLazyValue(sJSONLazyDocument *Document, size_t Offset) : Document(Document), Offset(Offset) {
+    }
+
+public:
+    // First member called Key, found by stepping over the members before it.
+    sJSONLazyValue operator[](std::string_view Key) const {
+        if (!IsObject()) {
+            return sJSONLazyValue();
+        }
+
+        size_t Position = Document->FirstEntry(Offset, '}');
+        while (Position != sJSONLazyDocument::NotFound) {
+            std::string_view Raw;
+            size_t Value;
+            if (!Document->ReadEntry(Position, true, Raw, Value)) {
+                break;
+            }
+            if (Raw == Key || (Raw.find('\\') != std::string_view::npos && Document->DecodedEquals(Raw, Key))) {
+                return sJSONLazyValue(Document, Value);
+            }
+
+            Position = Document->NextEntry(Value, '}');
+        }
+
+        return sJSONLazyValue();
+    }
+
+    sJSONLazyValue operator[](size_t Index) const {
+        if (!IsArray()) {
+            return sJSONLazyValue();
+        }
+
+        size_t Position = Document->FirstEntry(Offset, ']');
+        for (; Position != sJSONLazyDocument::NotFound && Index != 0; --Index) {
+            Position = Document->NextEntry(Position, ']');
+        }
+
+        return Position == sJSONLazyDocument::NotFound ? sJSONLazyValue() : sJSONLazyValue(Document, Position);
+    }
+
+    const bool IsValid() const {
+        return Document != nullptr && Offset < Document->GetCode().size();
+    }
+
+    const sJSONValueType GetType() const {
+        switch (IsValid() ? Document->GetCode()[Offset] : 'n') {
+            case '{': {
+                return sJSONValueType::Object;
+            }
+            case '[': {
+                return sJSONValueType::Array;
+            }
+            case 'n': {
+                return sJSONValueType::Null;
+            }
+            default: {
+                return sJSONValueType::Value;
+            }
+        }
+    }
+
+    const bool IsEmpty() const {
+        return GetType() == sJSONValueType::Null;
+    }
+
+    const bool IsArray() const {
+        return GetType() == sJSONValueType::Array;
+    }
+
+    const bool IsObject() const {
+        return GetType() == sJSONValueType::Object;
+    }
+
+    const bool IsRealValue() const {
+        return GetType() == sJSONValueType::Value;
+    }
+
+    const bool IsString() const {
+        return IsValid() && Document->GetCode()[Offset] == '\"';
+    }
+
+    bool Exsits(std::string_view Key) const {
+        return operator[](Key).IsValid();
+    }
+
+    // The JSON text of the value, found by skipping it.
+    std::string_view GetRaw() const {
+        if (!IsValid()) {
+            return std::string_view();
+        }
+
+        size_t End = Document->SkipValue(Offset);
+        if (End == sJSONLazyDocument::NotFound) {
+            return std::string_view();
+        }
+        return Document->GetCode().substr(Offset, End - Offset);
+    }
+
+    // Decodes the value as Type: std::string_view, std::string, bool or an arithmetic type. A value of
+    // another kind gives Type().
+    template<class Type>
+    Type To() const {
+        if constexpr (std::is_same_v<Type, std::string_view>) {
+            if (!IsString()) {
+                return std::string_view();
+            }
+
+            size_t End = Document->SkipString(Offset);
+            if (End == sJSONLazyDocument::NotFound) {
+                return std::string_view();
+            }
+            return Document->DecodeString(Document->GetCode().substr(Offset + 1, End - Offset - 2));
+        } else if constexpr (std::is_same_v<Type, std::string>) {
+            return std::string(To<std::string_view>());
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            return IsValid() && Document->GetCode().compare(Offset, 4, "true") == 0;
+        } else {
+            static_assert(std::is_arithmetic_v<Type>, "sJSONLazyValue::To needs a string, bool or number type");
+
+            sJSONNumber Number;
+            if (!IsRealValue() || IsString() || !sJSONParseNumber(GetRaw(), Number)) {
+                return Type();
+            }
+            switch (Number.Type) {
+                case sJSONNumberType::Double: {
+                    return static_cast<Type>(Number.Float);
+                }
+                case sJSONNumberType::UInt64: {
+                    return static_cast<Type>(Number.Unsigned);
+                }
+                default: {
+                    return static_cast<Type>(Number.Integer);
+                }
+            }
+        }
+    }
+
+    // Iterates the members of an object, or the elements of an array with empty keys.
+    sJSONLazyIterator begin() const;
+
+    sJSONLazyIterator end() const;
+
+    const size_t GetOffset() const {
+        return Offset;
+    }
+
+private:
+    sJSONLazyDocument *Document;
+    size_t Offset;
+};
+
+class sJSONLazyIterator {
+public:
+    using Member = std::pair<std::string_view, sJSONLazyValue>;
+
+public:
+    sJSONLazyIterator() : Document(nullptr), Position(sJSONLazyDocument::NotFound), IsObject(false) {
+    }
+
+    sJSONLazyIterator(sJSONLazyDocument *Document, size_t Position, bool IsObject)
+            : Document(Document), Position(Position), IsObject(IsObject) {
+        Read();
+    }
+
+public:
+    const Member &operator*() const {
+        return Current;
+    }
+
+    const Member *operator->() const {
+        return &Current;
+    }
+
+    sJSONLazyIterator &operator++() {
+        Position = Document->NextEntry(Current.second.GetOffset(), IsObject ? '}' : ']');
+        Read();
+
+        return *this;
+    }
+
+    bool operator==(const sJSONLazyIterator &Other) const {
+        return Position == Other.Position;
+    }
+
+    bool operator!=(const sJSONLazyIterator &Other) const {
+        return Position != Other.Position;
+    }
+
+private:
+    void Read() {
+        if (Position == sJSONLazyDocument::NotFound) {
+            return;
+        }
+
+        std::string_view Key;
+        size_t Value;
+        if (!Document->ReadEntry(Position, IsObject, Key, Value)) {
+            Position = sJSONLazyDocument::NotFound;
+            return;
+        }
+        Current = Member(Document->DecodeString(Key), sJSONLazyValue(Document, Value));
+    }
+
+private:
+    sJSONLazyDocument *Document;
+    size_t Position;
+    bool IsObject;
+    Member Current;
+};
+
+inline sJSONLazyIterator sJSONLazyValue::begin() const {
+    if (!IsObject() && !IsArray()) {
+        return sJSONLazyIterator();
+    }
+
+    bool Object = IsObject();
+    return sJSONLazyIterator(Document, Document->FirstEntry(Offset, Object ? '}' : ']'), Object);
+}
+
+inline sJSONLazyIterator sJSONLazyValue::end() const {
+    return sJSONLazyIterator();
+}
+
+inline sJSONLazyValue sJSONLazyDocument::GetRoot() {
+    size_t Position = SkipSpace(0);
+    if (Position >= Code.size()) {
+        PushError(Position);
+        return sJSONLazyValue();
+    }
+
+    return sJSONLazyValue(this, Position);
+}
+
+inline sJSONLazyValue sJSONLazyDocument::operator[](std::string_view Key) {
+    return GetRoot()[Key];
+}
+
+enum class sJSONPathStepType {
+    Key,
+    Index,
+    Wildcard
+};
+
+struct sJSONPathStep {
+    sJSONPathStepType Type;
+    std::string Key;
+    uint64_t Hash;
+    // Array position selected by the step. JSON Pointer tokens made of digits select both a key and
+    // an index, since the pointer does not say which kind of container it expects.
+    size_t Index;
+
+    __forceinline bool MatchesKey(std::string_view Name) const {
+        return Type == sJSONPathStepType::Wildcard || (Type == sJSONPathStepType::Key && Name == Key);
+    }
+
+    __forceinline bool MatchesIndex(size_t Position) const {
+        return Type == sJSONPathStepType::Wildcard || Index == Position;
+    }
+};
+
+// A JSON Pointer ("/store/book/0/title") or simple JSONPath ("$.store.book[*]['title']") compiled once
+// into a list of steps, to be run against any number of trees or lazy documents.
+class sJSONPath {
+public:
+    static constexpr size_t NoIndex = std::string_view::npos;
+
+public:
+    sJSONPath() : Valid(true) {
+    }
+
+    sJSONPath(std::string_view Expression) {
+        Valid = !Expression.empty() && Expression[0] == '$' ? CompileJSONPath(Expression) : CompilePointer(Expression);
+        if (!Valid) {
+            Steps.clear();
+        }
+    }
+
+public:
+    const bool IsValid() const {
+        return Valid;
+    }
+
+    // A path without wildcards selects at most one value.
+    const bool IsDefinite() const {
+        for (auto &Step : Steps) {
+            if (Step.Type == sJSONPathStepType::Wildcard) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const std::vector<sJSONPathStep> &GetSteps() const {
+        return Steps;
+    }
+
+    // Calls Visit(sJSONValue *) for every value the path selects until it returns false. Member
+    // lookups use the precomputed key hashes.
+    template<class Visitor>
+    bool Match(sJSONValue *Value, Visitor &&Visit, size_t Depth = 0) const {
+        if (!Valid || Value == nullptr) {
+            return true;
+        }
+        if (Depth == Steps.size()) {
+            return Visit(Value);
+        }
+
+        auto &Step = Steps[Depth];
+        switch (Value->GetType()) {
+            case sJSONValueType::Object: {
+                auto &Children = static_cast<sJSONObject *>(Value)->GetChildren();
+                if (Step.Type != sJSONPathStepType::Wildcard) {
+                    auto Node = Step.Type == sJSONPathStepType::Key ? Children.Find(sJSONKey{Step.Key, Step.Hash})
+                                                                   : nullptr;
+                    return Node == nullptr || Match(Node->Value, Visit, Depth + 1);
+                }
+
+                for (auto &Member : Children) {
+                    if (!Match(Member.second->Value, Visit, Depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case sJSONValueType::Array: {
+                auto &ValueSet = static_cast<sJSONArray *>(Value)->ValueSet;
+                if (Step.Type != sJSONPathStepType::Wildcard) {
+                    return Step.Index >= ValueSet.size() || Match(ValueSet[Step.Index], Visit, Depth + 1);
+                }
+
+                for (auto Element : ValueSet) {
+                    if (!Match(Element, Visit, Depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default: {
+                return true;
+            }
+        }
+    }
+
+    // First value selected in the tree, or nullptr.
+    sJSONValue *Find(sJSONRootNode Root) const {
+        sJSONValue *Result = nullptr;
+        Match(Root.GetObject(), [&](sJSONValue *Value) {
+            Result = Value;
+            return false;
+        });
+
+        return Result;
+    }
+
+    std::vector<sJSONValue *> FindAll(sJSONRootNode Root) const {
+        std::vector<sJSONValue *> Result;
+        Match(Root.GetObject(), [&](sJSONValue *Value) {
+            Result.push_back(Value);
+            return true;
+        });
+
+        return Result;
+    }
+
+    // First value selected in a lazy document. Only the members on the way are scanned.
+    sJSONLazyValue Find(sJSONLazyDocument &Document) const {
+        return Valid ? Find(Document.GetRoot(), 0) : sJSONLazyValue();
+    }
+
+    // Whether the raw key of a lazy document matches a key step, decoding it only if it is escaped.
+    static bool MatchesRawKey(sJSONLazyDocument &Document, const sJSONPathStep &Step, std::string_view Raw) {
+        if (Step.MatchesKey(Raw)) {
+            return true;
+        }
+
+        return Step.Type == sJSONPathStepType::Key && Raw.find('\\') != std::string_view::npos &&
+               Document.DecodedEquals(Raw, Step.Key);
+    }
+
+private:
+    sJSONLazyValue Find(sJSONLazyValue Value, size_t Depth) const {
+        if (Depth == Steps.size() || !Value.IsValid()) {
+            return Value;
+        }
+
+        auto &Step = Steps[Depth];
+        if (Step.Type != sJSONPathStepType::Wildcard) {
+            if (Value.IsObject()) {
+                return Step.Type == sJSONPathStepType::Key ? Find(Value[std::string_view(Step.Key)], Depth + 1)
+                                                          : sJSONLazyValue();
+            }
+            return Step.Index != NoIndex ? Find(Value[Step.Index], Depth + 1) : sJSONLazyValue();
+        }
+
+        for (auto &Item : Value) {
+            auto Result = Find(Item.second, Depth + 1);
+            if (Result.IsValid()) {
+                return Result;
+            }
+        }
+
+        return sJSONLazyValue();
+    }
+
+    void PushKey(std::string Key, size_t Index) {
+        uint64_t Hash = sJSONHashKey(Key);
+        Steps.push_back({sJSONPathStepType::Key, std::move(Key), Hash, Index});
+    }
+
+    static size_t ParseIndex(std::string_view Text) {
+        if (Text.empty() || Text.size() > 18 || (Text[0] == '0' && Text.size() > 1)) {
+            return NoIndex;
+        }
+
+        size_t Index = 0;
+        for (auto Character : Text) {
+            if (!sJSONIsDigit(Character)) {
+                return NoIndex;
+            }
+            Index = Index * 10 + (Character - '0');
+        }
+
+        return Index;
+    }
+
+    // RFC 6901: "" is the whole document, every "/" starts a token, "~1" stands for "/" and "~0" for "~".
+    bool CompilePointer(std::string_view Expression) {
+        if (Expression.empty()) {
+            return true;
+        }
+        if (Expression[0] != '/') {
+            return false;
+        }
+
+        size_t Position = 1;
+        while (true) {
+            size_t End = Expression.find('/', Position);
+            auto Token = Expression.substr(Position, End == std::string_view::npos ? End : End - Position);
+
+            std::string Key;
+            for (size_t Count = 0; Count < Token.size(); ++Count) {
+                if (Token[Count] != '~') {
+                    Key.push_back(Token[Count]);
+                } else if (Count + 1 < Token.size() && (Token[Count + 1] == '0' || Token[Count + 1] == '1')) {
+                    Key.push_back(Token[++Count] == '0' ? '~' : '/');
+                } else {
+                    return false;
+                }
+            }
+            PushKey(std::move(Key), ParseIndex(Token));
+
+            if (End == std::string_view::npos) {
+                return true;
+            }
+            Position = End + 1;
+        }
+    }
+
+    // "$" followed by ".name", ".*", "[n]", "[*]" and "['name']" / ["name"] steps.
+    bool CompileJSONPath(std::string_view Expression) {
+        size_t Position = 1;
+        while (Position < Expression.size()) {
+            if (Expression[Position] == '.') {
+                ++Position;
+                if (Position < Expression.size() && Expression[Position] == '*') {
+                    Steps.push_back({sJSONPathStepType::Wildcard, std::string(), 0, NoIndex});
+                    ++Position;
+                    continue;
+                }
+
+                size_t End = Expression.find_first_of(".[", Position);
+                auto Name = Expression.substr(Position, End == std::string_view::npos ? End : End - Position);
+                if (Name.empty()) {
+                    return false;
+                }
+                PushKey(std::string(Name), NoIndex);
+                Position += Name.size();
+                continue;
+            }
+            if (Expression[Position] != '[' || ++Position >= Expression.size()) {
+                return false;
+            }
+
+            char Character = Expression[Position];
+            if (Character == '*') {
+                Steps.push_back({sJSONPathStepType::Wildcard, std::string(), 0, NoIndex});
+                ++Position;
+            } else if (Character == '\'' || Character == '\"') {
+                std::string Key;
+                for (++Position; Position < Expression.size() && Expression[Position] != Character; ++Position) {
+                    if (Expression[Position] == '\\' && Position + 1 < Expression.size()) {
+                        ++Position;
+                    }
+                    Key.push_back(Expression[Position]);
+                }
+                if (Position++ >= Expression.size()) {
+                    return false;
+                }
+                PushKey(std::move(Key), NoIndex);
+            } else {
+                size_t End = Expression.find(']', Position);
+                auto Digits = Expression.substr(Position, End == std::string_view::npos ? End : End - Position);
+                size_t Index = ParseIndex(Digits);
+                if (Index == NoIndex) {
+                    return false;
+                }
+                Steps.push_back({sJSONPathStepType::Index, std::string(), 0, Index});
+                Position = End;
+            }
+
+            if (Position >= Expression.size() || Expression[Position] != ']') {
+                return false;
+            }
+            ++Position;
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<sJSONPathStep> Steps;
+    bool Valid;
+};
+
+// A group of paths resolved together. Against a lazy document every member is looked at once for all
+// paths, subtrees no path leads into are skipped, and scanning stops once every path is resolved.
+class sJSONPathSet {
+public:
+    static constexpr size_t MaxPaths = 64;
+    static constexpr size_t NotAdded = std::string_view::npos;
+
+public:
+    sJSONPathSet() : Definite(0) {
+    }
+
+public:
+    // Returns the index of the path in the set, or NotAdded if it is invalid or the set is full.
+    size_t Add(const sJSONPath &Path) {
+        if (!Path.IsValid() || Paths.size() == MaxPaths) {
+            return NotAdded;
+        }
+
+        if (Path.IsDefinite()) {
+            Definite |= 1ULL << Paths.size();
+        }
+        Paths.push_back(Path);
+
+        return Paths.size() - 1;
+    }
+
+    size_t Add(std::string_view Expression) {
+        return Add(sJSONPath(Expression));
+    }
+
+    const size_t Size() const {
+        return Paths.size();
+    }
+
+    const sJSONPath &GetPath(size_t Index) const {
+        return Paths[Index];
+    }
+
+    // Calls Visit(size_t Path, sJSONLazyValue Value) for the matches in document order. Visit returns
+    // true when it needs no more matches for that path; a path without wildcards is done after its
+    // first match anyway. Returns once every path is done or the document is exhausted.
+    template<class Visitor>
+    void Run(sJSONLazyDocument &Document, Visitor &&Visit) const {
+        uint64_t All = Paths.size() == 64 ? ~0ULL : (1ULL << Paths.size()) - 1;
+        uint64_t Resolved = 0;
+        auto Root = Document.GetRoot();
+        if (!Root.IsValid()) {
+            return;
+        }
+
+        for (size_t Path = 0; Path < Paths.size(); ++Path) {
+            if (Paths[Path].GetSteps().empty() && (Visit(Path, Root) || (Definite >> Path & 1) != 0)) {
+                Resolved |= 1ULL << Path;
+            }
+        }
+        size_t End;
+        Walk(Document, Root, 0, All & ~Resolved, Resolved, All, Visit, End);
+    }
+
+    // First match of every path, in the order they were added; invalid values for paths without one.
+    void FindFirst(sJSONLazyDocument &Document, std::vector<sJSONLazyValue> &Results) const {
+        Results.assign(Paths.size(), sJSONLazyValue());
+        Run(Document, [&](size_t Path, sJSONLazyValue Value) {
+            Results[Path] = Value;
+            return true;
+        });
+    }
+
+    void FindFirst(sJSONRootNode Root, std::vector<sJSONValue *> &Results) const {
+        Results.resize(Paths.size());
+        for (size_t Path = 0; Path < Paths.size(); ++Path) {
+            Results[Path] = Paths[Path].Find(Root);
+        }
+    }
+
+private:
+    // Returns false once every path is resolved, which ends the whole run. End is the offset just past
+    // the container when the walk reached its closer, so the caller carries on from there instead of
+    // scanning the container again, or NotFound when the walk stopped early.
+    template<class Visitor>
+    bool Walk(sJSONLazyDocument &Document, sJSONLazyValue Value, size_t Depth, uint64_t Active, uint64_t &Resolved,
+              uint64_t All, Visitor &Visit, size_t &End) const {
+        End = sJSONLazyDocument::NotFound;
+        bool IsObject = Value.IsObject();
+        if (!IsObject && !Value.IsArray()) {
+            return true;
+        }
+
+        char Closer = IsObject ? '}' : ']';
+        size_t Last = Value.GetOffset() + 1;
+        size_t Position = Document.FirstEntry(Value.GetOffset(), Closer);
+        for (size_t Index = 0; Position != sJSONLazyDocument::NotFound; ++Index) {
+            std::string_view Key;
+            size_t Offset;
+            if (!Document.ReadEntry(Position, IsObject, Key, Offset)) {
+                return true;
+            }
+
+            sJSONLazyValue Child(&Document, Offset);
+            uint64_t Next = 0;
+            for (uint64_t Bits = Active; Bits != 0; Bits &= Bits - 1) {
+                size_t Path = sJSONCountTrailingZeros(Bits);
+                auto &Steps = Paths[Path].GetSteps();
+                auto &Step = Steps[Depth];
+                if (IsObject ? !sJSONPath::MatchesRawKey(Document, Step, Key) : !Step.MatchesIndex(Index)) {
+                    continue;
+                }
+
+                if (Depth + 1 < Steps.size()) {
+                    Next |= 1ULL << Path;
+                } else if (Visit(Path, Child) || (Definite >> Path & 1) != 0) {
+                    Resolved |= 1ULL << Path;
+                }
+            }
+
+            size_t ChildEnd = sJSONLazyDocument::NotFound;
+            if ((Next & ~Resolved) != 0 &&
+                !Walk(Document, Child, Depth + 1, Next & ~Resolved, Resolved, All, Visit, ChildEnd)) {
+                return false;
+            }
+            if (Resolved == All) {
+                return false;
+            }
+            Active &= ~Resolved;
+            if (Active == 0) {
+                return true;
+            }
+
+            Last = ChildEnd != sJSONLazyDocument::NotFound ? ChildEnd : Document.SkipValue(Offset);
+            if (Last == sJSONLazyDocument::NotFound) {
+                return true;
+            }
+            Position = Document.EntryAfter(Last, Closer);
+        }
+
+        if (!Document.GetStatus().ExsitsError()) {
+            End = Document.SkipSpace(Last) + 1;
+        }
+        return true;
+    }
+
+private:
+    std::vector<sJSONPath> Paths;
+    uint64_t Definite;
+};
+
+enum class sJSONHandlerResult {
+    Continue,
+    Skip,
+    Abort
+};
+
+// Receives the events of sJSONReader. Returning Skip from StartObject/StartArray drops that container
+// and all of its events, returning Skip from Key drops the member's value, and Abort stops the parse.
+// Strings and keys are only guaranteed to stay valid for the duration of the call.
+class sJSONHandler {
+public:
+    virtual ~sJSONHandler() = default;
+
+public:
+    virtual sJSONHandlerResult StartObject() {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Key(std::string_view /* Key */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult EndObject() {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult StartArray() {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult EndArray() {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult String(std::string_view /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Int(int /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Int64(int64_t /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult UInt64(uint64_t /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Double(double /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Bool(bool /* Value */) {
+        return sJSONHandlerResult::Continue;
+    }
+
+    virtual sJSONHandlerResult Null() {
+        return sJSONHandlerResult::Continue;
+    }
+};
+
+// Handler in front of another one that counts the events, depth and node sizes of a parse into an
+// sJSONParseStats. Only used while stats are collected, so parsing without them pays nothing.
+template<class Handler>
+class sJSONStatsHandler : public sJSONHandler {
+public:
+    sJSONStatsHandler(Handler &Target, sJSONParseStats &Stats) : Target(&Target), Stats(&Stats), Depth(0) {
+    }
+
+public:
+    sJSONHandlerResult StartObject() override {
+        // The root object belongs to the document before the parse starts.
+        Count(Stats->Objects, Depth == 0 ? 0 : sizeof(sJSONObject));
+        return Open(Target->StartObject());
+    }
+
+    sJSONHandlerResult Key(std::string_view Key) override {
+        Count(Stats->Members, sizeof(sJSONElementNode));
+        return Target->Key(Key);
+    }
+
+    sJSONHandlerResult EndObject() override {
+        ++Stats->Tokens;
+        --Depth;
+        return Target->EndObject();
+    }
+
+    sJSONHandlerResult StartArray() override {
+        Count(Stats->Arrays, sizeof(sJSONArray));
+        return Open(Target->StartArray());
+    }
+
+    sJSONHandlerResult EndArray() override {
+        ++Stats->Tokens;
+        --Depth;
+        return Target->EndArray();
+    }
+
+    sJSONHandlerResult String(std::string_view Value) override {
+        Count(Stats->Strings, sizeof(sJSONstring));
+        return Target->String(Value);
+    }
+
+    sJSONHandlerResult Int(int Value) override {
+        Count(Stats->Numbers, sizeof(sJSONInt));
+        return Target->Int(Value);
+    }
+
+    sJSONHandlerResult Int64(int64_t Value) override {
+        Count(Stats->Numbers, sizeof(sJSONInt64));
+        return Target->Int64(Value);
+    }
+
+    sJSONHandlerResult UInt64(uint64_t Value) override {
+        Count(Stats->Numbers, sizeof(sJSONUInt64));
+        return Target->UInt64(Value);
+    }
+
+    sJSONHandlerResult Double(double Value) override {
+        Count(Stats->Numbers, sizeof(sJSONDouble));
+        return Target->Double(Value);
+    }
+
+    sJSONHandlerResult Bool(bool Value) override {
+        Count(Stats->Literals, sizeof(sJSONBoolean));
+        return Target->Bool(Value);
+    }
+
+    sJSONHandlerResult Null() override {
+        Count(Stats->Literals, sizeof(sJSONNull));
+        return Target->Null();
+    }
+
+private:
+    void Count(sJSONNodeCount &Kind, size_t Bytes) {
+        ++Stats->Tokens;
+        ++Kind.Count;
+        Kind.Bytes += Bytes;
+    }
+
+    // A skipped container sends no end event, so it does not count as a level.
+    sJSONHandlerResult Open(sJSONHandlerResult Result) {
+        if (Result != sJSONHandlerResult::Skip && ++Depth > Stats->MaxDepth) {
+            Stats->MaxDepth = Depth;
+        }
+
+        return Result;
+    }
+
+private:
+    Handler *Target;
+    sJSONParseStats *Stats;
+    size_t Depth;
+};
+
+// The token type of a closing bracket, '}' or ']'.
+inline sJSONTokenType sJSONCloserType(char Closer) {
+    return Closer == '}' ? sJSONTokenType::BigRight : sJSONTokenType::MiddleRight;
+}
+
+// Event-driven parser. Only the stack of open containers is kept, so memory grows with nesting depth
+// and not with the size of the document.
+class sJSONReader {
+public:
+    sJSONReader(std::string_view Code, sJSONSIMDLevel Level = sJSONActiveSIMDLevel)
+            : Lexer(Code, &Status, Level), Input(Code), Aborted(false) {
+    }
+
+public:
+    // Returns true when the whole document was read without error and the handler did not abort.
+    template<class Handler>
+    bool Parse(Handler &Target) {
+        Stack.clear();
+        Aborted = false;
+
+        bool AfterValue = false;
+        bool Opened = false;
+        if (!ReadValue(Target, Lexer(), AfterValue, Opened) || !ReadContainers(Target, 0, AfterValue, Opened)) {
+            return false;
+        }
+
+        if (Lexer().Type != sJSONTokenType::End) {
+            PushUnknownToken();
+            return false;
+        }
+
+        return true;
+    }
+
+    // Reads the input as the inside of an array: a non-empty, comma separated list of values without
+    // brackets. The handler sees the values but no StartArray/EndArray around them.
+    template<class Handler>
+    bool ParseElements(Handler &Target) {
+        Stack.assign(1, 0);
+        Aborted = false;
+
+        bool AfterValue = false;
+        bool Opened = false;
+        return ReadValue(Target, Lexer(), AfterValue, Opened) && ReadContainers(Target, 1, AfterValue, Opened);
+    }
+
+    sJSONParserStatus &GetStatus() {
+        return Status;
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+    const bool IsAborted() const {
+        return Aborted;
+    }
+
+    std::string_view GetInput() const {
+        return Input;
+    }
+
+    const size_t GetLine() const {
+        return Lexer.GetLine();
+    }
+
+    // Offset just past the last token read.
+    const size_t GetPosition() const {
+        return Lexer.GetPosition();
+    }
+
+    void SetScanTimer(double *Seconds) {
+        Lexer.SetScanTimer(Seconds);
+    }
+
+    // Points the reader at a new input and clears the previous errors, keeping all buffers.
+    void Reset(std::string_view Code) {
+        Lexer.Reset(Code);
+        Input = Code;
+        Status.ErrorInfo.clear();
+        Aborted = false;
+    }
+
+    void PushUnknownToken() {
+        if (!Status.ExsitsError()) {
+            Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
+        }
+    }
+
+private:
+    // Reads tokens until every container above the bottom Floor entries of the stack is closed. A floor
+    // entry is never closed by a bracket; it ends with the input instead.
+    template<class Handler>
+    bool ReadContainers(Handler &Target, size_t Floor, bool AfterValue, bool Opened) {
+        while (!Stack.empty()) {
+            auto Token = Lexer();
+            if (Token.Type == sJSONTokenType::End) {
+                if (Stack.size() == Floor && AfterValue) {
+                    return true;
+                }
+
+                Status.ErrorInfo.push_back("<Bad sJSON tree>");
+                return false;
+            }
+
+            bool IsObject = Stack.back() != 0;
+            auto Closer = IsObject ? sJSONTokenType::BigRight : sJSONTokenType::MiddleRight;
+            if (AfterValue || (Opened && Token.Type == Closer)) {
+                if (AfterValue && Token.Type == sJSONTokenType::Comma) {
+                    AfterValue = false;
+                    continue;
+                }
+                if (Token.Type != Closer || Stack.size() == Floor) {
+                    PushUnknownToken();
+                    return false;
+                }
+
+                Stack.pop_back();
+                Opened = false;
+                AfterValue = true;
+                if (!Accept(IsObject ? Target.EndObject() : Target.EndArray())) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            Opened = false;
+            if (IsObject) {
+                if (Token.Type != sJSONTokenType::string) {
+                    PushUnknownToken();
+                    return false;
+                }
+
+                std::string_view Key;
+                if (!DecodeString(Token, Key)) {
+                    return false;
+                }
+
+                auto Result = Target.Key(Key);
+                if (Lexer().Type != sJSONTokenType::Colon) {
+                    PushUnknownToken();
+                    return false;
+                }
+
+                Token = Lexer();
+                if (Result == sJSONHandlerResult::Abort) {
+                    Aborted = true;
+                    return false;
+                }
+                if (Result == sJSONHandlerResult::Skip) {
+                    if (!SkipValue(Token)) {
+                        return false;
+                    }
+
+                    AfterValue = true;
+                    continue;
+                }
+            }
+
+            if (!ReadValue(Target, Token, AfterValue, Opened)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<class Handler>
+    bool ReadValue(Handler &Target, const sJSONToken &Token, bool &AfterValue, bool &Opened) {
+        AfterValue = true;
+        switch (Token.Type) {
+            case sJSONTokenType::BigLeft:
+            case sJSONTokenType::MiddleLeft: {
+                bool IsObject = Token.Type == sJSONTokenType::BigLeft;
+                auto Result = IsObject ? Target.StartObject() : Target.StartArray();
+                if (Result == sJSONHandlerResult::Skip) {
+                    return SkipValue(Token);
+                }
+                if (!Accept(Result)) {
+                    return false;
+                }
+
+                Stack.push_back(IsObject ? 1 : 0);
+                AfterValue = false;
+                Opened = true;
+                return true;
+            }
+            case sJSONTokenType::string: {
+                std::string_view Text;
+                return DecodeString(Token, Text) && Accept(Target.String(Text));
+            }
+            case sJSONTokenType::Number:
+            case sJSONTokenType::Float: {
+                sJSONNumber Number;
+                if (!sJSONParseNumber(Lexer.GetText(Token), Number)) {
+                    Status.ErrorInfo.push_back("<Bad number>");
+                    return false;
+                }
+
+                switch (Number.Type) {
+                    case sJSONNumberType::Int: {
+                        return Accept(Target.Int(static_cast<int>(Number.Integer)));
+                    }
+                    case sJSONNumberType::Int64: {
+                        return Accept(Target.Int64(Number.Integer));
+                    }
+                    case sJSONNumberType::UInt64: {
+                        return Accept(Target.UInt64(Number.Unsigned));
+                    }
+                    default: {
+                        return Accept(Target.Double(Number.Float));
+                    }
+                }
+            }
+            case sJSONTokenType::Boolean: {
+                return Accept(Target.Bool(Lexer.GetText(Token) == "true"));
+            }
+            case sJSONTokenType::Null: {
+                return Accept(Target.Null());
+            }
+            case sJSONTokenType::End: {
+                Status.ErrorInfo.push_back("<Bad sJSON tree>");
+                return false;
+            }
+            default: {
+                PushUnknownToken();
+                return false;
+            }
+        }
+    }
+
+    // Steps over the value starting at Token with the checks ReadValue makes: separators in their places,
+    // matching brackets and valid numbers. Strings are not decoded.
+    bool SkipValue(sJSONToken Token) {
+        std::string Closers;
+        bool InKey = false;
+        do {
+            if (InKey && Token.Type != sJSONTokenType::string) {
+                return Fail(Token);
+            }
+
+            switch (Token.Type) {
+                case sJSONTokenType::BigLeft:
+                case sJSONTokenType::MiddleLeft: {
+                    Closers.push_back(Token.Type == sJSONTokenType::BigLeft ? '}' : ']');
+                    Token = Lexer();
+                    if (Token.Type == sJSONCloserType(Closers.back())) {
+                        Closers.pop_back();
+                        break;
+                    }
+                    InKey = Closers.back() == '}';
+                    continue;
+                }
+                case sJSONTokenType::string: {
+                    if (!InKey) {
+                        break;
+                    }
+
+                    InKey = false;
+                    Token = Lexer();
+                    if (Token.Type != sJSONTokenType::Colon) {
+                        return Fail(Token);
+                    }
+                    Token = Lexer();
+                    continue;
+                }
+                case sJSONTokenType::Number:
+                case sJSONTokenType::Float: {
+                    sJSONNumber Number;
+                    if (!sJSONParseNumber(Lexer.GetText(Token), Number)) {
+                        Status.ErrorInfo.push_back("<Bad number>");
+                        return false;
+                    }
+                    break;
+                }
+                case sJSONTokenType::Boolean:
+                case sJSONTokenType::Null: {
+                    break;
+                }
+                default: {
+                    return Fail(Token);
+                }
+            }
+
+            // A value is complete; its container goes on after a comma or ends.
+            while (!Closers.empty()) {
+                Token = Lexer();
+                if (Token.Type == sJSONTokenType::Comma) {
+                    InKey = Closers.back() == '}';
+                    break;
+                }
+                if (Token.Type != sJSONCloserType(Closers.back())) {
+                    return Fail(Token);
+                }
+                Closers.pop_back();
+            }
+            if (Closers.empty()) {
+                return true;
+            }
+
+            Token = Lexer();
+        } while (true);
+    }
+
+    bool Fail(const sJSONToken &Token) {
+        if (Token.Type == sJSONTokenType::End) {
+            Status.ErrorInfo.push_back("<Bad sJSON tree>");
+        } else {
+            PushUnknownToken();
+        }
+
+        return false;
+    }
+
+    bool Accept(sJSONHandlerResult Result) {
+        if (Result == sJSONHandlerResult::Abort) {
+            Aborted = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DecodeString(const sJSONToken &Token, std::string_view &Text) {
+        Text = Lexer.GetText(Token);
+        if (!Token.Escaped) {
+            return true;
+        }
+
+        Buffer.resize(Text.size());
+        size_t Size = sJSONDecodeString(Text, Buffer.data());
+        if (Size == sJSONBadString) {
+            Status.ErrorInfo.push_back("<Bad string>");
+            return false;
+        }
+
+        Text = std::string_view(Buffer.data(), Size);
+        return true;
+    }
+
+private:
+    sJSONParserStatus Status;
+    sJSONLexer Lexer;
+    std::string_view Input;
+    std::vector<char> Stack;
+    std::string Buffer;
+    bool Aborted;
+};
+
+// Value tags of the binary form. Int, Int64 and UInt64 keep the integer types of the tree apart.
+enum class sJSONBinaryTag : uint8_t {
+    Null,
+    False,
+    True,
+    Int,
+    Int64,
+    UInt64,
+    Double,
+    String,
+    Array,
+    Object
+};
+
+inline constexpr char sJSONBinaryMagic[4] = {'s', 'J', 'B', '1'};
+
+// LEB128: seven bits per byte, least significant first. Writes at most 10 bytes.
+inline char *sJSONEncodeVarint(char *Buffer, uint64_t Value) {
+    while (Value >= 0x80) {
+        *Buffer++ = static_cast<char>(Value | 0x80);
+        Value >>= 7;
+    }
+    *Buffer++ = static_cast<char>(Value);
+
+    return Buffer;
+}
+
+inline uint64_t sJSONZigZag(int64_t Value) {
+    return (static_cast<uint64_t>(Value) << 1) ^ static_cast<uint64_t>(Value >> 63);
+}
+
+inline int64_t sJSONUnZigZag(uint64_t Value) {
+    return static_cast<int64_t>(Value >> 1) ^ -static_cast<int64_t>(Value & 1);
+}
+
+// Event-driven reader for the binary form written by sJSONWriter::WriteBinary: a magic, a table of
+// every distinct key, and the root value as tagged values with varint counts and lengths. Every
+// length, count and key index is checked against the input, so corrupt or truncated data is rejected
+// without reading out of bounds. Keys and strings are handed out as views into Data.
+class sJSONBinaryReader {
+public:
+    sJSONBinaryReader(std::string_view Data) : Data(Data), Position(0), Muted(NotMuted), Aborted(false) {
+    }
+
+public:
+    // Returns true when the whole input was read without error and the handler did not abort.
+    template<class Handler>
+    bool Parse(Handler &Target) {
+        Position = 0;
+        Muted = NotMuted;
+        Aborted = false;
+        Keys.clear();
+        Stack.clear();
+        Status.ErrorInfo.clear();
+
+        if (Data.size() < sizeof(sJSONBinaryMagic) || memcmp(Data.data(), sJSONBinaryMagic, 4) != 0) {
+            return Fail();
+        }
+        Position = sizeof(sJSONBinaryMagic);
+
+        uint64_t KeyCount;
+        if (!ReadVarint(KeyCount) || KeyCount > Data.size() - Position) {
+            return Fail();
+        }
+        Keys.reserve(KeyCount);
+        for (uint64_t Count = 0; Count < KeyCount; ++Count) {
+            uint64_t Length;
+            if (!ReadVarint(Length) || Length > Data.size() - Position) {
+                return Fail();
+            }
+            Keys.push_back(Data.substr(Position, Length));
+            Position += Length;
+        }
+
+        if (!ReadValue(Target, false)) {
+            return false;
+        }
+        while (!Stack.empty()) {
+            auto &Frame = Stack.back();
+            if (Frame.Remaining == 0) {
+                bool IsObject = Frame.IsObject;
+                bool Emit = Muted == NotMuted;
+                if (Muted == Stack.size()) {
+                    Muted = NotMuted;
+                }
+                Stack.pop_back();
+                if (Emit && !Accept(IsObject ? Target.EndObject() : Target.EndArray())) {
+                    return false;
+                }
+                continue;
+            }
+
+            --Frame.Remaining;
+            bool Skip = false;
+            if (Frame.IsObject) {
+                uint64_t Index;
+                if (!ReadVarint(Index) || Index >= Keys.size()) {
+                    return Fail();
+                }
+                if (Muted == NotMuted) {
+                    auto Result = Target.Key(Keys[Index]);
+                    if (!Accept(Result)) {
+                        return false;
+                    }
+                    Skip = Result == sJSONHandlerResult::Skip;
+                }
+            }
+            if (!ReadValue(Target, Skip)) {
+                return false;
+            }
+        }
+
+        return Position == Data.size() || Fail();
+    }
+
+    // Checks the whole input without building anything.
+    bool Validate() {
+        sJSONHandler Nothing;
+        return Parse(Nothing);
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+    const bool IsAborted() const {
+        return Aborted;
+    }
+
+private:
+    static constexpr size_t NotMuted = std::string_view::npos;
+
+    struct Frame {
+        bool IsObject;
+        uint64_t Remaining;
+    };
+
+private:
+    // Reads one tagged value. Skipped values and everything inside a skipped container are read and
+    // checked, but not reported to the handler.
+    template<class Handler>
+    bool ReadValue(Handler &Target, bool Skip) {
+        if (Position >= Data.size()) {
+            return Fail();
+        }
+
+        bool Emit = Muted == NotMuted && !Skip;
+        auto Tag = static_cast<sJSONBinaryTag>(Data[Position++]);
+        switch (Tag) {
+            case sJSONBinaryTag::Null: {
+                return !Emit || Accept(Target.Null());
+            }
+            case sJSONBinaryTag::False:
+            case sJSONBinaryTag::True: {
+                return !Emit || Accept(Target.Bool(Tag == sJSONBinaryTag::True));
+            }
+            case sJSONBinaryTag::Int:
+            case sJSONBinaryTag::Int64: {
+                uint64_t Raw;
+                if (!ReadVarint(Raw)) {
+                    return Fail();
+                }
+
+                int64_t Value = sJSONUnZigZag(Raw);
+                if (Tag == sJSONBinaryTag::Int64) {
+                    return !Emit || Accept(Target.Int64(Value));
+                }
+                if (Value < std::numeric_limits<int>::min() || Value > std::numeric_limits<int>::max()) {
+                    return Fail();
+                }
+                return !Emit || Accept(Target.Int(static_cast<int>(Value)));
+            }
+            case sJSONBinaryTag::UInt64: {
+                uint64_t Value;
+                if (!ReadVarint(Value)) {
+                    return Fail();
+                }
+                return !Emit || Accept(Target.UInt64(Value));
+            }
+            case sJSONBinaryTag::Double: {
+                if (Data.size() - Position < 8) {
+                    return Fail();
+                }
+
+                uint64_t Bits = 0;
+                for (int Byte = 7; Byte >= 0; --Byte) {
+                    Bits = Bits << 8 | static_cast<unsigned char>(Data[Position + Byte]);
+                }
+                Position += 8;
+
+                double Value;
+                memcpy(&Value, &Bits, sizeof(Value));
+                return !Emit || Accept(Target.Double(Value));
+            }
+            case sJSONBinaryTag::String: {
+                uint64_t Length;
+                if (!ReadVarint(Length) || Length > Data.size() - Position) {
+                    return Fail();
+                }
+
+                auto Value = Data.substr(Position, Length);
+                Position += Length;
+                return !Emit || Accept(Target.String(Value));
+            }
+            case sJSONBinaryTag::Array:
+            case sJSONBinaryTag::Object: {
+                bool IsObject = Tag == sJSONBinaryTag::Object;
+                uint64_t Count;
+                if (!ReadVarint(Count) || Count > (Data.size() - Position) / (IsObject ? 2 : 1)) {
+                    return Fail();
+                }
+
+                bool Mute = Muted == NotMuted && Skip;
+                if (Emit) {
+                    auto Result = IsObject ? Target.StartObject() : Target.StartArray();
+                    if (!Accept(Result)) {
+                        return false;
+                    }
+                    Mute = Result == sJSONHandlerResult::Skip;
+                }
+
+                Stack.push_back({IsObject, Count});
+                if (Mute) {
+                    Muted = Stack.size();
+                }
+                return true;
+            }
+            default: {
+                --Position;
+                return Fail();
+            }
+        }
+    }
+
+    bool ReadVarint(uint64_t &Value) {
+        Value = 0;
+        for (int Shift = 0; Shift < 64 && Position < Data.size(); Shift += 7) {
+            auto Byte = static_cast<unsigned char>(Data[Position++]);
+            if (Shift == 63 && Byte > 1) {
+                return false;
+            }
+
+            Value |= static_cast<uint64_t>(Byte & 0x7F) << Shift;
+            if ((Byte & 0x80) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool Accept(sJSONHandlerResult Result) {
+        if (Result == sJSONHandlerResult::Abort) {
+            Aborted = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Fail() {
+        Status.ErrorInfo.push_back("Bad binary data at byte " + std::to_string(Position) + ".");
+        return false;
+    }
+
+private:
+    sJSONParserStatus Status;
+    std::string_view Data;
+    size_t Position;
+    std::vector<std::string_view> Keys;
+    std::vector<Frame> Stack;
+    size_t Muted;
+    bool Aborted;
+};
+
+// Snapshot layout written by sJSONWriter::WriteSnapshot. Every integer is little-endian and every
+// reference is a byte offset from the start of the snapshot, so the bytes can be mapped and read in
+// place. A slot is a 4-byte sJSONBinaryTag, a 4-byte offset and an 8-byte payload: the number
+// itself, or the length of a string or the count of a container. Arrays point at their element
+// slots; objects point at an index capacity, the members as key offset, key length and slot, and,
+// past sJSONMemberTable::IndexThreshold members, an open-addressing table of member positions.
+inline constexpr char sJSONSnapshotMagic[4] = {'s', 'J', 'S', '1'};
+
+struct sJSONSnapshotLayout {
+    static constexpr size_t RootSlot = 8;
+    static constexpr size_t HeaderSize = 24;
+    static constexpr size_t SlotSize = 16;
+    static constexpr size_t MemberSize = 24;
+};
+
+inline uint32_t sJSONLoad32(const char *Data) {
+    uint32_t Value = 0;
+    for (int Byte = 3; Byte >= 0; --Byte) {
+        Value = Value << 8 | static_cast<unsigned char>(Data[Byte]);
+    }
+
+    return Value;
+}
+
+inline uint64_t sJSONLoad64(const char *Data) {
+    return sJSONLoad32(Data) | static_cast<uint64_t>(sJSONLoad32(Data + 4)) << 32;
+}
+
+inline void sJSONStore32(char *Data, uint32_t Value) {
+    for (int Byte = 0; Byte < 4; ++Byte) {
+        Data[Byte] = static_cast<char>(Value >> (Byte * 8));
+    }
+}
+
+inline void sJSONStore64(char *Data, uint64_t Value) {
+    sJSONStore32(Data, static_cast<uint32_t>(Value));
+    sJSONStore32(Data + 4, static_cast<uint32_t>(Value >> 32));
+}
+
+class sJSONSnapshotIterator;
+
+// Handle to a value inside a snapshot: the snapshot bytes and the offset of the value's slot. Every
+// offset is checked against the snapshot before it is followed, so a damaged snapshot gives empty
+// handles rather than reads out of bounds. An empty handle stands for a missing member or element.
+class sJSONSnapshotValue {
+public:
+    sJSONSnapshotValue() : Slot(0) {
+    }
+
+    sJSONSnapshotValue(std::string_view Data, size_t Slot) : Data(Data), Slot(Slot) {
+    }
+
+public:
+    sJSONSnapshotValue operator[](std::string_view Key) const {
+        size_t Members = GetMembers();
+        if (Members == 0) {
+            return sJSONSnapshotValue();
+        }
+
+        uint64_t Count = GetCount();
+        size_t Capacity = sJSONLoad32(Data.data() + Members - 4);
+        size_t Table = Members + Count * sJSONSnapshotLayout::MemberSize;
+        if (Capacity == 0 || (Capacity & (Capacity - 1)) != 0 || Capacity > (Data.size() - Table) / 4) {
+            for (uint64_t Position = 0; Position < Count; ++Position) {
+                size_t Member = Members + Position * sJSONSnapshotLayout::MemberSize;
+                if (GetKey(Member) == Key) {
+                    return sJSONSnapshotValue(Data, Member + 8);
+                }
+            }
+
+            return sJSONSnapshotValue();
+        }
+
+        size_t Mask = Capacity - 1;
+        size_t Index = static_cast<size_t>(sJSONHashKey(Key)) & Mask;
+        for (size_t Probe = 0; Probe < Capacity; ++Probe, Index = (Index + 1) & Mask) {
+            uint32_t Entry = sJSONLoad32(Data.data() + Table + Index * 4);
+            if (Entry == 0 || Entry > Count) {
+                break;
+            }
+
+            size_t Member = Members + (Entry - 1) * sJSONSnapshotLayout::MemberSize;
+            if (GetKey(Member) == Key) {
+                return sJSONSnapshotValue(Data, Member + 8);
+            }
+        }
+
+        return sJSONSnapshotValue();
+    }
+
+    sJSONSnapshotValue operator[](size_t Index) const {
+        if (GetTag() != sJSONBinaryTag::Array || Index >= GetCount()) {
+            return sJSONSnapshotValue();
+        }
+
+        size_t Elements = GetOffset();
+        if (GetCount() > (Data.size() - std::min(Elements, Data.size())) / sJSONSnapshotLayout::SlotSize) {
+            return sJSONSnapshotValue();
+        }
+        return sJSONSnapshotValue(Data, Elements + Index * sJSONSnapshotLayout::SlotSize);
+    }
+
+    const bool IsValid() const {
+        return Slot != 0 && Slot <= Data.size() && Data.size() - Slot >= sJSONSnapshotLayout::SlotSize;
+    }
+
+    const sJSONBinaryTag GetTag() const {
+        return IsValid() ? static_cast<sJSONBinaryTag>(sJSONLoad32(Data.data() + Slot)) : sJSONBinaryTag::Null;
+    }
+
+    const sJSONValueType GetType() const {
+        switch (GetTag()) {
+            case sJSONBinaryTag::Object: {
+                return sJSONValueType::Object;
+            }
+            case sJSONBinaryTag::Array: {
+                return sJSONValueType::Array;
+            }
+            case sJSONBinaryTag::Null: {
+                return sJSONValueType::Null;
+            }
+            default: {
+                return sJSONValueType::Value;
+            }
+        }
+    }
+
+    const bool IsEmpty() const {
+        return GetType() == sJSONValueType::Null;
+    }
+
+    const bool IsArray() const {
+        return GetType() == sJSONValueType::Array;
+    }
+
+    const bool IsObject() const {
+        return GetType() == sJSONValueType::Object;
+    }
+
+    const bool IsRealValue() const {
+        return GetType() == sJSONValueType::Value;
+    }
+
+    const bool IsString() const {
+        return GetTag() == sJSONBinaryTag::String;
+    }
+
+    bool Exsits(std::string_view Key) const {
+        return operator[](Key).IsValid();
+    }
+
+    // Number of members or elements; 0 for anything else.
+    const size_t Size() const {
+        return IsArray() || IsObject() ? static_cast<size_t>(GetCount()) : 0;
+    }
+
+    // Reads the value as Type: std::string_view, std::string, bool or an arithmetic type. A value of
+    // another kind gives Type(). Strings are views into the snapshot.
+    template<class Type>
+    Type To() const {
+        if constexpr (std::is_same_v<Type, std::string_view>) {
+            if (!IsString() || GetOffset() > Data.size() || GetCount() > Data.size() - GetOffset()) {
+                return std::string_view();
+            }
+
+            return Data.substr(GetOffset(), static_cast<size_t>(GetCount()));
+        } else if constexpr (std::is_same_v<Type, std::string>) {
+            return std::string(To<std::string_view>());
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            return GetTag() == sJSONBinaryTag::True;
+        } else {
+            static_assert(std::is_arithmetic_v<Type>, "sJSONSnapshotValue::To needs a string, bool or number type");
+
+            switch (GetTag()) {
+                case sJSONBinaryTag::Int:
+                case sJSONBinaryTag::Int64: {
+                    return static_cast<Type>(static_cast<int64_t>(GetCount()));
+                }
+                case sJSONBinaryTag::UInt64: {
+                    return static_cast<Type>(GetCount());
+                }
+                case sJSONBinaryTag::Double: {
+                    double Value;
+                    uint64_t Bits = GetCount();
+                    memcpy(&Value, &Bits, sizeof(Value));
+                    return static_cast<Type>(Value);
+                }
+                default: {
+                    return Type();
+                }
+            }
+        }
+    }
+
+    // Iterates the members of an object, or the elements of an array with empty keys.
+    sJSONSnapshotIterator begin() const;
+
+    sJSONSnapshotIterator end() const;
+
+    const size_t GetSlot() const {
+        return Slot;
+    }
+
+private:
+    friend class sJSONSnapshotView;
+
+    const size_t GetOffset() const {
+        return sJSONLoad32(Data.data() + Slot + 4);
+    }
+
+    // The payload: the bits of a number, or the length of a string or the count of a container.
+    const uint64_t GetCount() const {
+        return sJSONLoad64(Data.data() + Slot + 8);
+    }
+
+    // Offset of the first member when this is an object whose members lie inside the snapshot, else 0.
+    const size_t GetMembers() const {
+        if (GetTag() != sJSONBinaryTag::Object) {
+            return 0;
+        }
+
+        size_t Members = GetOffset() + 4;
+        if (Members > Data.size() || GetCount() > (Data.size() - Members) / sJSONSnapshotLayout::MemberSize) {
+            return 0;
+        }
+        return Members;
+    }
+
+    std::string_view GetKey(size_t Member) const {
+        size_t Offset = sJSONLoad32(Data.data() + Member);
+        size_t Length = sJSONLoad32(Data.data() + Member + 4);
+        if (Offset > Data.size() || Length > Data.size() - Offset) {
+            return std::string_view();
+        }
+
+        return Data.substr(Offset, Length);
+    }
+
+private:
+    std::string_view Data;
+    size_t Slot;
+};
+
+class sJSONSnapshotIterator {
+public:
+    using Member = std::pair<std::string_view, sJSONSnapshotValue>;
+
+public:
+    sJSONSnapshotIterator() : Position(0), Remaining(0), IsObject(false) {
+    }
+
+    sJSONSnapshotIterator(std::string_view Data, size_t Position, uint64_t Remaining, bool IsObject)
+            : Data(Data), Position(Position), Remaining(Remaining), IsObject(IsObject) {
+        Read();
+    }
+
+public:
+    const Member &operator*() const {
+        return Current;
+    }
+
+    const Member *operator->() const {
+        return &Current;
+    }
+
+    sJSONSnapshotIterator &operator++() {
+        Position += IsObject ? sJSONSnapshotLayout::MemberSize : sJSONSnapshotLayout::SlotSize;
+        --Remaining;
+        Read();
+
+        return *this;
+    }
+
+    bool operator==(const sJSONSnapshotIterator &Other) const {
+        return Remaining == Other.Remaining;
+    }
+
+    bool operator!=(const sJSONSnapshotIterator &Other) const {
+        return Remaining != Other.Remaining;
+    }
+
+private:
+    void Read() {
+        if (Remaining == 0) {
+            return;
+        }
+        if (!IsObject) {
+            Current = Member(std::string_view(), sJSONSnapshotValue(Data, Position));
+            return;
+        }
+
+        size_t Offset = sJSONLoad32(Data.data() + Position);
+        size_t Length = sJSONLoad32(Data.data() + Position + 4);
+        auto Key = Offset > Data.size() || Length > Data.size() - Offset ? std::string_view()
+                                                                          : Data.substr(Offset, Length);
+        Current = Member(Key, sJSONSnapshotValue(Data, Position + 8));
+    }
+
+private:
+    std::string_view Data;
+    size_t Position;
+    uint64_t Remaining;
+    bool IsObject;
+    Member Current;
+};
+
+inline sJSONSnapshotIterator sJSONSnapshotValue::begin() const {
+    if (IsObject()) {
+        size_t Members = GetMembers();
+        return Members == 0 ? sJSONSnapshotIterator() : sJSONSnapshotIterator(Data, Members, GetCount(), true);
+    }
+    if (IsArray() && operator[](size_t(0)).IsValid()) {
+        return sJSONSnapshotIterator(Data, GetOffset(), GetCount(), false);
+    }
+
+    return sJSONSnapshotIterator();
+}
+
+inline sJSONSnapshotIterator sJSONSnapshotValue::end() const {
+    return sJSONSnapshotIterator();
+}
+
+// Read-only view of a snapshot written by sJSONWriter::WriteSnapshot, usually the view of an
+// sJSONMappedFile. Opening it only checks the header; nothing is parsed or allocated, and values
+// are read from the snapshot bytes as they are visited. Data must outlive the view and its values.
+class sJSONSnapshotView {
+public:
+    sJSONSnapshotView(std::string_view Data) : Data(Data) {
+    }
+
+public:
+    const bool IsValid() const {
+        return Data.size() >= sJSONSnapshotLayout::HeaderSize && memcmp(Data.data(), sJSONSnapshotMagic, 4) == 0 &&
+               sJSONLoad32(Data.data() + 4) == Data.size();
+    }
+
+    sJSONSnapshotValue GetRoot() const {
+        return IsValid() ? sJSONSnapshotValue(Data, sJSONSnapshotLayout::RootSlot) : sJSONSnapshotValue();
+    }
+
+    sJSONSnapshotValue operator[](std::string_view Key) const {
+        return GetRoot()[Key];
+    }
+
+    bool Exsits(std::string_view Key) const {
+        return GetRoot().Exsits(Key);
+    }
+
+    // Checks every slot, key and string of the snapshot, for files that may be damaged. Navigation
+    // is safe without it; this only tells in advance whether every value can be read.
+    bool Validate() const {
+        if (!IsValid() || !GetRoot().IsObject()) {
+            return false;
+        }
+
+        // A well-formed snapshot has every slot at its own 16 bytes, so visiting more slots than that
+        // means the offsets loop back on themselves.
+        size_t Budget = Data.size() / sJSONSnapshotLayout::SlotSize;
+        std::vector<size_t> Pending(1, sJSONSnapshotLayout::RootSlot);
+        while (!Pending.empty()) {
+            sJSONSnapshotValue Value(Data, Pending.back());
+            Pending.pop_back();
+            if (Budget-- == 0 || !Value.IsValid()) {
+                return false;
+            }
+
+            switch (Value.GetTag()) {
+                case sJSONBinaryTag::Null:
+                case sJSONBinaryTag::False:
+                case sJSONBinaryTag::True:
+                case sJSONBinaryTag::Int:
+                case sJSONBinaryTag::Int64:
+                case sJSONBinaryTag::UInt64:
+                case sJSONBinaryTag::Double: {
+                    break;
+                }
+                case sJSONBinaryTag::String: {
+                    if (Value.GetOffset() > Data.size() || Value.GetCount() > Data.size() - Value.GetOffset()) {
+                        return false;
+                    }
+                    break;
+                }
+                case sJSONBinaryTag::Array: {
+                    if (Value.GetCount() != 0 && !Value[size_t(0)].IsValid()) {
+                        return false;
+                    }
+                    for (uint64_t Index = 0; Index < Value.GetCount(); ++Index) {
+                        Pending.push_back(Value.GetOffset() + Index * sJSONSnapshotLayout::SlotSize);
+                    }
+                    break;
+                }
+                case sJSONBinaryTag::Object: {
+                    size_t Members = Value.GetMembers();
+                    if (Members == 0) {
+                        return false;
+                    }
+
+                    uint64_t Count = Value.GetCount();
+                    size_t Capacity = sJSONLoad32(Data.data() + Members - 4);
+                    size_t Table = Members + Count * sJSONSnapshotLayout::MemberSize;
+                    if ((Capacity & (Capacity - 1)) != 0 || Capacity > (Data.size() - Table) / 4) {
+                        return false;
+                    }
+                    for (size_t Index = 0; Index < Capacity; ++Index) {
+                        if (sJSONLoad32(Data.data() + Table + Index * 4) > Count) {
+                            return false;
+                        }
+                    }
+                    for (uint64_t Position = 0; Position < Count; ++Position) {
+                        size_t Member = Members + Position * sJSONSnapshotLayout::MemberSize;
+                        size_t Offset = sJSONLoad32(Data.data() + Member);
+                        if (Offset > Data.size() || sJSONLoad32(Data.data() + Member + 4) > Data.size() - Offset) {
+                            return false;
+                        }
+                        Pending.push_back(Member + 8);
+                    }
+                    break;
+                }
+                default: {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    std::string_view GetData() const {
+        return Data;
+    }
+
+private:
+    std::string_view Data;
+};
+
+struct sJSONBuilderFrame {
+    sJSONValue *Container;
+    bool IsArray;
+    std::string_view Tag;
+    size_t Begin;
+};
+
+// Handler that turns reader events into an sJSONRootNode tree allocated from a document.
+class sJSONTreeBuilder : public sJSONHandler {
+public:
+    // The members of the root object are stored in Root, which has to belong to Target.
+    sJSONTreeBuilder(sJSONDocument &Target, sJSONObject *Root, std::string_view Input, sJSONInputMode Mode,
+                     sJSONKeyPool *KeyPool = nullptr)
+            : Document(&Target), RootObject(Root), Input(Input), Mode(Mode), KeyPool(KeyPool), BadRoot(false) {
+        if (KeyPool != nullptr) {
+            KeyCache.assign(KeyCacheSize, sJSONKey{std::string_view(), 0});
+        }
+    }
+
+public:
+    sJSONHandlerResult StartObject() override {
+        if (Stack.empty()) {
+            Stack.push_back({RootObject, false, "", MemberStack.size()});
+        } else {
+            Stack.push_back({Document->CreateObject(), false, Tag, MemberStack.size()});
+        }
+
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult Key(std::string_view Key) override {
+        Tag = KeyPool == nullptr ? CreateString(Key) : InternKey(Key);
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult EndObject() override {
+        auto &Frame = Stack.back();
+        auto Object = static_cast<sJSONObject *>(Frame.Container);
+        for (size_t Position = Frame.Begin; Position < MemberStack.size(); ++Position) {
+            MemberStack[Position].second->Edit.Parent = &Object->Edit;
+        }
+        Object->Children.Assign(MemberStack.data() + Frame.Begin, MemberStack.data() + MemberStack.size());
+        MemberStack.resize(Frame.Begin);
+
+        return CloseFrame();
+    }
+
+    sJSONHandlerResult StartArray() override {
+        if (Stack.empty()) {
+            return RejectRoot();
+        }
+
+        Stack.push_back({Document->CreateArray(), true, Tag, ValueStack.size()});
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult EndArray() override {
+        auto &Frame = Stack.back();
+        auto &ValueSet = static_cast<sJSONArray *>(Frame.Container)->ValueSet;
+        ValueSet.assign(ValueStack.begin() + Frame.Begin, ValueStack.end());
+        ValueStack.resize(Frame.Begin);
+
+        return CloseFrame();
+    }
+
+    sJSONHandlerResult String(std::string_view Value) override {
+        return InsertValue(Document->Create<sJSONstring>(CreateString(Value)));
+    }
+
+    sJSONHandlerResult Int(int Value) override {
+        return InsertValue(Document->Create<sJSONInt>(Value));
+    }
+
+    sJSONHandlerResult Int64(int64_t Value) override {
+        return InsertValue(Document->Create<sJSONInt64>(Value));
+    }
+
+    sJSONHandlerResult UInt64(uint64_t Value) override {
+        return InsertValue(Document->Create<sJSONUInt64>(Value));
+    }
+
+    sJSONHandlerResult Double(double Value) override {
+        return InsertValue(Document->Create<sJSONDouble>(Value));
+    }
+
+    sJSONHandlerResult Bool(bool Value) override {
+        return InsertValue(Document->Create<sJSONBoolean>(Value));
+    }
+
+    sJSONHandlerResult Null() override {
+        return InsertValue(Document->Create<sJSONNull>());
+    }
+
+    const bool IsBadRoot() const {
+        return BadRoot;
+    }
+
+    // Prepares the builder for another document in the same target, keeping its stacks.
+    void Reset(sJSONObject *Root) {
+        RootObject = Root;
+        Stack.clear();
+        ValueStack.clear();
+        MemberStack.clear();
+        Tag = std::string_view();
+        BadRoot = false;
+    }
+
+    // Prepares the builder for the bare value list read by sJSONReader::ParseElements. The values are
+    // stored in Target by FinishElements().
+    void ResetElements(sJSONArray *Target) {
+        Reset(nullptr);
+        Stack.push_back({Target, true, "", 0});
+    }
+
+    sJSONHandlerResult FinishElements() {
+        return EndArray();
+    }
+
+    // The innermost container that is still open, or nullptr outside of the root.
+    sJSONValue *GetOpenContainer() const {
+        return Stack.empty() ? nullptr : Stack.back().Container;
+    }
+
+private:
+    sJSONHandlerResult RejectRoot() {
+        BadRoot = true;
+        return sJSONHandlerResult::Abort;
+    }
+
+    sJSONHandlerResult CloseFrame() {
+        auto Frame = Stack.back();
+        Stack.pop_back();
+        if (Stack.empty()) {
+            return sJSONHandlerResult::Continue;
+        }
+
+        Tag = Frame.Tag;
+        return InsertValue(Frame.Container);
+    }
+
+    sJSONHandlerResult InsertValue(sJSONValue *Value) {
+        if (Stack.empty()) {
+            return RejectRoot();
+        }
+
+        auto &Frame = Stack.back();
+        if (Frame.IsArray) {
+            ValueStack.push_back(Value);
+            return sJSONHandlerResult::Continue;
+        }
+
+        MemberStack.emplace_back(Tag, Document->CreateNode(Tag, Value));
+
+        return sJSONHandlerResult::Continue;
+    }
+
+    // Recently seen keys are remembered locally so that repeated keys skip the shared pool's lock.
+    std::string_view InternKey(std::string_view Key) {
+        uint64_t Hash = sJSONHashKey(Key);
+        auto &Cached = KeyCache[Hash & (KeyCacheSize - 1)];
+        if (Cached.Hash != Hash || Cached.Text.data() == nullptr || Cached.Text != Key) {
+            Cached = KeyPool->Intern(Key, Hash);
+        }
+
+        return Cached.Text;
+    }
+
+    std::string_view CreateString(std::string_view String) {
+        if (Mode == sJSONInputMode::Reference && String.data() >= Input.data() &&
+            String.data() + String.size() <= Input.data() + Input.size()) {
+            return String;
+        }
+
+        return Document->CreateString(String);
+    }
+
+private:
+    static constexpr size_t KeyCacheSize = 256;
+
+private:
+    sJSONDocument *Document;
+    sJSONObject *RootObject;
+    std::string_view Input;
+    sJSONInputMode Mode;
+    sJSONKeyPool *KeyPool;
+    std::vector<sJSONKey> KeyCache;
+    std::vector<sJSONBuilderFrame> Stack;
+    std::vector<sJSONValue *> ValueStack;
+    std::vector<sJSONMemberTable::Member> MemberStack;
+    std::string_view Tag;
+    bool BadRoot;
+};
+
+class sJSONParser {
+public:
+    sJSONParser(std::string Code)
+            : OwnedCode(std::move(Code)), Reader(OwnedCode), Mode(sJSONInputMode::Copy), KeyPool(nullptr),
+              Observer(nullptr), ValidateUTF8(false), RootObject(nullptr) {
+    }
+
+    // Parses Code in place. With sJSONInputMode::Reference, keys and strings without escapes are views
+    // into Code, so Code has to outlive the resulting tree.
+    sJSONParser(std::string_view Code, sJSONInputMode Mode)
+            : Reader(Code), Mode(Mode), KeyPool(nullptr), Observer(nullptr), ValidateUTF8(false),
+              RootObject(nullptr) {
+    }
+
+    sJSONParser(const sJSONParser &) = delete;
+
+    sJSONParser &operator=(const sJSONParser &) = delete;
+
+public:
+    sJSONRootNode Parse() {
+        return Parse(OwnedDocument);
+    }
+
+    // Builds the tree inside Target, replacing whatever it held before. The result stays valid for as
+    // long as Target does, independent of the parser.
+    sJSONRootNode Parse(sJSONDocument &Target) {
+        Target.Reset();
+        Reader.Reset(Reader.GetInput());
+        RootObject = Target.GetRootObject();
+        if (ValidateUTF8) {
+            size_t Invalid = sJSONFindInvalidUTF8(Reader.GetInput());
+            if (Invalid != Reader.GetInput().size()) {
+                Reader.GetStatus().ErrorInfo.push_back("Bad UTF-8 at byte " + std::to_string(Invalid) + ".");
+                return sJSONRootNode(RootObject);
+            }
+        }
+
+        sJSONTreeBuilder Builder(Target, RootObject, Reader.GetInput(), Mode, KeyPool);
+        if (Observer == nullptr) {
+            Reader.Parse(Builder);
+        } else {
+            ParseWithStats(Target, Builder);
+        }
+        if (Builder.IsBadRoot()) {
+            Reader.PushUnknownToken();
+        }
+
+        return sJSONRootNode(RootObject);
+    }
+
+    // Loads the binary form written by sJSONWriter::WriteBinary instead of JSON text. With
+    // sJSONInputMode::Reference, keys and strings are views into the binary input.
+    sJSONRootNode ParseBinary() {
+        return ParseBinary(OwnedDocument);
+    }
+
+    sJSONRootNode ParseBinary(sJSONDocument &Target) {
+        Target.Reset();
+        Reader.Reset(Reader.GetInput());
+        RootObject = Target.GetRootObject();
+
+        sJSONBinaryReader Binary(Reader.GetInput());
+        sJSONTreeBuilder Builder(Target, RootObject, Reader.GetInput(), Mode, KeyPool);
+        Binary.Parse(Builder);
+        Reader.GetStatus().ErrorInfo = Binary.GetStatus().ErrorInfo;
+        if (Builder.IsBadRoot()) {
+            Reader.GetStatus().ErrorInfo.push_back("<Bad sJSON tree>");
+        }
+
+        return sJSONRootNode(RootObject);
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Reader.GetStatus();
+    }
+
+    // Takes keys from Pool instead of copying them into the document. Pool must outlive the tree.
+    void SetKeyPool(sJSONKeyPool *Pool) {
+        KeyPool = Pool;
+    }
+
+    // Measures every following Parse and reports it to Observer; nullptr turns measuring off again.
+    void SetStatsObserver(sJSONStatsObserver *Target) {
+        Observer = Target;
+    }
+
+    // Checks that the whole input is well-formed UTF-8 before parsing it. Off by default, so inputs in
+    // other 8-bit encodings keep passing through unchanged.
+    void SetUTF8Validation(bool Enable) {
+        ValidateUTF8 = Enable;
+    }
+
+private:
+    void ParseWithStats(sJSONDocument &Target, sJSONTreeBuilder &Builder) {
+        sJSONParseStats Stats{};
+        auto &Arena = Target.GetArena();
+        size_t UsedBytes = Arena.GetUsedBytes();
+        size_t Chunks = Arena.GetChunkCount();
+
+        sJSONStatsHandler<sJSONTreeBuilder> Counter(Builder, Stats);
+        Reader.SetScanTimer(&Stats.LexSeconds);
+        auto Start = std::chrono::steady_clock::now();
+        Stats.Failed = !Reader.Parse(Counter);
+        double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        Reader.SetScanTimer(nullptr);
+
+        Stats.BuildSeconds = Seconds > Stats.LexSeconds ? Seconds - Stats.LexSeconds : 0;
+        Stats.BytesConsumed = Reader.GetPosition();
+        Stats.ArenaBytes = Arena.GetUsedBytes() - UsedBytes;
+        Stats.ArenaChunks = Arena.GetChunkCount() - Chunks;
+        Observer->OnParse(Stats);
+    }
+
+private:
+    std::string OwnedCode;
+    sJSONReader Reader;
+    sJSONInputMode Mode;
+    sJSONKeyPool *KeyPool;
+    sJSONStatsObserver *Observer;
+    bool ValidateUTF8;
+    sJSONDocument OwnedDocument;
+    sJSONObject *RootObject;
+};
+
+enum class sJSONPushStatus {
+    NeedMoreData,
+    Complete,
+    Error
+};
+
+// Incremental parser for a document that arrives in pieces, e.g. from a socket. Every Feed call
+// carries on where the previous one stopped, including inside a string, escape, number or literal
+// split across chunks, so parsing overlaps receiving. Events are reported as soon as their token is
+// complete and chunks do not need to outlive the call that hands them over.
+class sJSONPushParser {
+public:
+    // Reports the events to Target, which must outlive the parser.
+    sJSONPushParser(sJSONHandler &Target) : Target(&Target), Document(nullptr), RootObject(nullptr) {
+        Reset();
+    }
+
+    // Builds the tree into Target; it can be read with GetRoot() once the document is complete.
+    sJSONPushParser(sJSONDocument &Target) : Target(nullptr), Document(&Target), RootObject(nullptr) {
+        Reset();
+    }
+
+    sJSONPushParser(const sJSONPushParser &) = delete;
+
+    sJSONPushParser &operator=(const sJSONPushParser &) = delete;
+
+public:
+    // Parses the next piece of the document. Complete means a whole document has been read; only
+    // whitespace may follow it.
+    sJSONPushStatus Feed(std::string_view Chunk) {
+        if (State == sJSONPushStatus::Error) {
+            return State;
+        }
+
+        size_t Position = 0;
+        if (Partial != PartialToken::None && !Resume(Chunk, Position)) {
+            return UpdateState();
+        }
+
+        while (State != sJSONPushStatus::Error && Position < Chunk.size()) {
+            char Character = Chunk[Position];
+            switch (Character) {
+                case '\n': {
+                    ++Line;
+                    ++Position;
+                    break;
+                }
+                case ' ':
+                case '\t':
+                case '\r': {
+                    ++Position;
+                    break;
+                }
+                case '{':
+                case '[': {
+                    ++Position;
+                    Open(Character == '{');
+                    break;
+                }
+                case '}':
+                case ']': {
+                    ++Position;
+                    Close(Character == '}');
+                    break;
+                }
+                case ',': {
+                    ++Position;
+                    Comma();
+                    break;
+                }
+                case ':': {
+                    ++Position;
+                    Colon();
+                    break;
+                }
+                case '\"': {
+                    size_t Begin = ++Position;
+                    Escaped = false;
+                    Position = ScanString(Chunk, Position);
+                    if (Position == Chunk.size()) {
+                        Partial = PartialToken::String;
+                        Pending.assign(Chunk.data() + Begin, Chunk.size() - Begin);
+                        break;
+                    }
+
+                    CompleteString(Chunk.substr(Begin, Position++ - Begin));
+                    break;
+                }
+                default: {
+                    size_t Begin = Position;
+                    if ((Character >= '0' && Character <= '9') || Character == '-') {
+                        Partial = PartialToken::Number;
+                    } else if (IsWordCharacter(Character)) {
+                        Partial = PartialToken::Word;
+                    } else {
+                        UnknownToken();
+                        break;
+                    }
+
+                    Position = ScanWord(Chunk, Position);
+                    if (Position == Chunk.size()) {
+                        Pending.assign(Chunk.data() + Begin, Chunk.size() - Begin);
+                        break;
+                    }
+
+                    CompleteWord(Chunk.substr(Begin, Position - Begin));
+                    break;
+                }
+            }
+        }
+
+        return UpdateState();
+    }
+
+    // Marks the end of the input. A number or literal at the very end is completed here; a document
+    // that is still open is an error.
+    sJSONPushStatus Finish() {
+        if (State == sJSONPushStatus::Error) {
+            return State;
+        }
+
+        if (Partial == PartialToken::String) {
+            Status.ErrorInfo.push_back("Not match \" of the begin of \"");
+            State = sJSONPushStatus::Error;
+            return State;
+        }
+        if (Partial != PartialToken::None) {
+            CompleteWord(Pending);
+        }
+        if (State != sJSONPushStatus::Error && Expect != Expecting::Done) {
+            Status.ErrorInfo.push_back("<Bad sJSON tree>");
+            State = sJSONPushStatus::Error;
+        }
+
+        return UpdateState();
+    }
+
+    // Starts over on a new document, keeping the buffers. When building a tree, the document is reset.
+    void Reset() {
+        if (Document != nullptr) {
+            Document->Reset();
+            RootObject = Document->GetRootObject();
+            if (Builder == nullptr) {
+                Builder = std::make_unique<sJSONTreeBuilder>(*Document, RootObject, std::string_view(),
+                                                             sJSONInputMode::Copy);
+            }
+            Builder->Reset(RootObject);
+            Target = Builder.get();
+        }
+
+        Status.ErrorInfo.clear();
+        Stack.clear();
+        Pending.clear();
+        Expect = Expecting::Value;
+        Partial = PartialToken::None;
+        State = sJSONPushStatus::NeedMoreData;
+        Muted = NotMuted;
+        Line = 1;
+        Escaped = false;
+        EscapeNext = false;
+        SkipNext = false;
+        Aborted = false;
+    }
+
+    // The tree built so far; only meaningful for a parser constructed with a document.
+    sJSONRootNode GetRoot() {
+        return sJSONRootNode(RootObject);
+    }
+
+    const sJSONPushStatus GetState() const {
+        return State;
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+    const bool IsAborted() const {
+        return Aborted;
+    }
+
+private:
+    enum class Expecting {
+        Value,
+        ValueOrClose,
+        Key,
+        KeyOrClose,
+        Colon,
+        CommaOrClose,
+        Done
+    };
+
+    enum class PartialToken {
+        None,
+        String,
+        Number,
+        Word
+    };
+
+    static constexpr size_t NotMuted = std::string_view::npos;
+
+private:
+    static __forceinline bool IsWordCharacter(char Character) {
+        return (Character >= 'a' && Character <= 'z') || (Character >= 'A' && Character <= 'Z') ||
+               (Character >= '0' && Character <= '9') || Character == '_';
+    }
+
+    static __forceinline bool IsNumberCharacter(char Character) {
+        return (Character >= '0' && Character <= '9') || Character == '-' || Character == '+' || Character == '.' ||
+               Character == 'e' || Character == 'E';
+    }
+
+    // Finishes the token left open by the previous chunk. Returns false when it is still not complete.
+    bool Resume(std::string_view Chunk, size_t &Position) {
+        if (Partial == PartialToken::String) {
+            Position = ScanString(Chunk, 0);
+            Pending.append(Chunk.data(), Position);
+            if (Position == Chunk.size()) {
+                return false;
+            }
+
+            ++Position;
+            CompleteString(Pending);
+            return true;
+        }
+
+        Position = ScanWord(Chunk, 0);
+        Pending.append(Chunk.data(), Position);
+        if (Position == Chunk.size()) {
+            return false;
+        }
+
+        CompleteWord(Pending);
+        return true;
+    }
+
+    // Offset of the closing quote, or the end of the chunk when the string goes on in the next one.
+    size_t ScanString(std::string_view Chunk, size_t Position) {
+        if (EscapeNext && Position < Chunk.size()) {
+            EscapeNext = false;
+            ++Position;
+        }
+        while (Position < Chunk.size()) {
+            Position = sJSONScanString(Chunk.data() + Position, Chunk.data() + Chunk.size()) - Chunk.data();
+            if (Position == Chunk.size()) {
+                break;
+            }
+
+            char Character = Chunk[Position];
+            if (Character == '\"') {
+                return Position;
+            }
+            if (Character == '\\') {
+                Escaped = true;
+                if (++Position == Chunk.size()) {
+                    EscapeNext = true;
+                    return Position;
+                }
+            } else if (Character == '\n') {
+                ++Line;
+            }
+
+            ++Position;
+        }
+
+        return Position;
+    }
+
+    size_t ScanWord(std::string_view Chunk, size_t Position) {
+        if (Partial == PartialToken::Number) {
+            while (Position < Chunk.size() && IsNumberCharacter(Chunk[Position])) {
+                ++Position;
+            }
+        } else {
+            while (Position < Chunk.size() && IsWordCharacter(Chunk[Position])) {
+                ++Position;
+            }
+        }
+
+        return Position;
+    }
+
+    void CompleteString(std::string_view Raw) {
+        Partial = PartialToken::None;
+        std::string_view Text = Raw;
+        if (Escaped) {
+            Buffer.resize(Raw.size());
+            size_t Size = sJSONDecodeString(Raw, Buffer.data());
+            if (Size == sJSONBadString) {
+                Status.ErrorInfo.push_back("<Bad string>");
+                State = sJSONPushStatus::Error;
+                return;
+            }
+            Text = std::string_view(Buffer.data(), Size);
+        }
+
+        if (Expect == Expecting::Key || Expect == Expecting::KeyOrClose) {
+            Expect = Expecting::Colon;
+            if (Muted == NotMuted) {
+                auto Result = Target->Key(Text);
+                SkipNext = Result == sJSONHandlerResult::Skip;
+                Accept(Result);
+            }
+            return;
+        }
+
+        bool Emit;
+        if (BeginValue(Emit) && Emit) {
+            Accept(Target->String(Text));
+        }
+    }
+
+    void CompleteWord(std::string_view Text) {
+        bool IsNumber = Partial == PartialToken::Number;
+        Partial = PartialToken::None;
+        if (!IsNumber && Text != "true" && Text != "false" && Text != "null") {
+            UnknownToken();
+            return;
+        }
+
+        bool Emit;
+        if (!BeginValue(Emit)) {
+            return;
+        }
+        if (!IsNumber) {
+            if (Emit) {
+                Accept(Text == "null" ? Target->Null() : Target->Bool(Text == "true"));
+            }
+            return;
+        }
+
+        sJSONNumber Number;
+        if (!sJSONParseNumber(Text, Number)) {
+            Status.ErrorInfo.push_back("<Bad number>");
+            State = sJSONPushStatus::Error;
+            return;
+        }
+        if (!Emit) {
+            return;
+        }
+        switch (Number.Type) {
+            case sJSONNumberType::Int: {
+                Accept(Target->Int(static_cast<int>(Number.Integer)));
+                break;
+            }
+            case sJSONNumberType::Int64: {
+                Accept(Target->Int64(Number.Integer));
+                break;
+            }
+            case sJSONNumberType::UInt64: {
+                Accept(Target->UInt64(Number.Unsigned));
+                break;
+            }
+            default: {
+                Accept(Target->Double(Number.Float));
+                break;
+            }
+        }
+    }
+
+    // Checks that a value may stand here and tells whether its events are reported: not when it is
+    // inside a skipped container or the value of a skipped member.
+    bool BeginValue(bool &Emit) {
+        if (Expect != Expecting::Value && Expect != Expecting::ValueOrClose) {
+            UnknownToken();
+            return false;
+        }
+
+        Emit = Muted == NotMuted && !SkipNext;
+        SkipNext = false;
+        Expect = Stack.empty() ? Expecting::Done : Expecting::CommaOrClose;
+        return true;
+    }
+
+    void Open(bool IsObject) {
+        bool Emit;
+        if (!BeginValue(Emit)) {
+            return;
+        }
+
+        bool Mute = Muted == NotMuted && !Emit;
+        if (Emit) {
+            auto Result = IsObject ? Target->StartObject() : Target->StartArray();
+            if (!Accept(Result)) {
+                return;
+            }
+            Mute = Result == sJSONHandlerResult::Skip;
+        }
+
+        Stack.push_back(IsObject ? 1 : 0);
+        if (Mute) {
+            Muted = Stack.size();
+        }
+        Expect = IsObject ? Expecting::KeyOrClose : Expecting::ValueOrClose;
+    }
+
+    void Close(bool IsObject) {
+        auto Opened = IsObject ? Expecting::KeyOrClose : Expecting::ValueOrClose;
+        if (Stack.empty() || (Stack.back() != 0) != IsObject ||
+            (Expect != Expecting::CommaOrClose && Expect != Opened)) {
+            UnknownToken();
+            return;
+        }
+
+        bool Emit = Muted == NotMuted;
+        if (Muted == Stack.size()) {
+            Muted = NotMuted;
+        }
+        Stack.pop_back();
+        Expect = Stack.empty() ? Expecting::Done : Expecting::CommaOrClose;
+        if (Emit) {
+            Accept(IsObject ? Target->EndObject() : Target->EndArray());
+        }
+    }
+
+    void Comma() {
+        if (Expect != Expecting::CommaOrClose) {
+            UnknownToken();
+            return;
+        }
+
+        Expect = Stack.back() != 0 ? Expecting::Key : Expecting::Value;
+    }
+
+    void Colon() {
+        if (Expect != Expecting::Colon) {
+            UnknownToken();
+            return;
+        }
+
+        Expect = Expecting::Value;
+    }
+
+    bool Accept(sJSONHandlerResult Result) {
+        if (Result == sJSONHandlerResult::Abort) {
+            Aborted = true;
+            if (Builder != nullptr && Builder->IsBadRoot()) {
+                UnknownToken();
+            }
+            State = sJSONPushStatus::Error;
+            return false;
+        }
+
+        return true;
+    }
+
+    void UnknownToken() {
+        if (!Status.ExsitsError()) {
+            Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Line) + ".");
+        }
+        State = sJSONPushStatus::Error;
+    }
+
+    sJSONPushStatus UpdateState() {
+        if (State != sJSONPushStatus::Error) {
+            bool Complete = Expect == Expecting::Done && Partial == PartialToken::None;
+            State = Complete ? sJSONPushStatus::Complete : sJSONPushStatus::NeedMoreData;
+        }
+
+        return State;
+    }
+
+private:
+    sJSONHandler *Target;
+    sJSONDocument *Document;
+    sJSONObject *RootObject;
+    std::unique_ptr<sJSONTreeBuilder> Builder;
+    sJSONParserStatus Status;
+    std::vector<char> Stack;
+    std::string Pending;
+    std::string Buffer;
+    Expecting Expect;
+    PartialToken Partial;
+    sJSONPushStatus State;
+    size_t Muted;
+    size_t Line;
+    bool Escaped;
+    bool EscapeNext;
+    bool SkipNext;
+    bool Aborted;
+};
+
+// Word tags of sJSONTapeDocument, kept in the top byte of every tape word.
+enum class sJSONTapeTag : uint8_t {
+    Root = 'r',
+    StartObject = '{',
+    EndObject = '}',
+    StartArray = '[',
+    EndArray = ']',
+    String = '\"',
+    Int64 = 'l',
+    UInt64 = 'u',
+    Double = 'd',
+    True = 't',
+    False = 'f',
+    Null = 'n'
+};
+
+// Handler that appends reader events to a tape and its string buffer; see sJSONTapeDocument.
+class sJSONTapeBuilder : public sJSONHandler {
+public:
+    static constexpr uint64_t PayloadMask = (uint64_t(1) << 56) - 1;
+    static constexpr uint64_t CountMask = 0xFFFFFF;
+
+public:
+    sJSONTapeBuilder(std::vector<uint64_t> &Tape, std::string &Strings) : Tape(&Tape), Strings(&Strings) {
+    }
+
+public:
+    static __forceinline uint64_t Word(sJSONTapeTag Tag, uint64_t Payload) {
+        return static_cast<uint64_t>(Tag) << 56 | Payload;
+    }
+
+    sJSONHandlerResult StartObject() override {
+        return Open(sJSONTapeTag::StartObject);
+    }
+
+    sJSONHandlerResult Key(std::string_view Key) override {
+        AppendString(Key);
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult EndObject() override {
+        return Close(sJSONTapeTag::StartObject, sJSONTapeTag::EndObject);
+    }
+
+    sJSONHandlerResult StartArray() override {
+        return Open(sJSONTapeTag::StartArray);
+    }
+
+    sJSONHandlerResult EndArray() override {
+        return Close(sJSONTapeTag::StartArray, sJSONTapeTag::EndArray);
+    }
+
+    sJSONHandlerResult String(std::string_view Value) override {
+        CountValue();
+        AppendString(Value);
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult Int(int Value) override {
+        return Int64(Value);
+    }
+
+    sJSONHandlerResult Int64(int64_t Value) override {
+        return AppendNumber(sJSONTapeTag::Int64, static_cast<uint64_t>(Value));
+    }
+
+    sJSONHandlerResult UInt64(uint64_t Value) override {
+        return AppendNumber(sJSONTapeTag::UInt64, Value);
+    }
+
+    sJSONHandlerResult Double(double Value) override {
+        uint64_t Bits;
+        memcpy(&Bits, &Value, sizeof(Bits));
+        return AppendNumber(sJSONTapeTag::Double, Bits);
+    }
+
+    sJSONHandlerResult Bool(bool Value) override {
+        CountValue();
+        Tape->push_back(Word(Value ? sJSONTapeTag::True : sJSONTapeTag::False, 0));
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult Null() override {
+        CountValue();
+        Tape->push_back(Word(sJSONTapeTag::Null, 0));
+        return sJSONHandlerResult::Continue;
+    }
+
+    void Reset() {
+        Stack.clear();
+    }
+
+private:
+    struct Frame {
+        size_t Start;
+        uint64_t Count;
+    };
+
+private:
+    __forceinline void CountValue() {
+        if (!Stack.empty()) {
+            ++Stack.back().Count;
+        }
+    }
+
+    sJSONHandlerResult Open(sJSONTapeTag Tag) {
+        CountValue();
+        Stack.push_back({Tape->size(), 0});
+        Tape->push_back(Word(Tag, 0));
+        return sJSONHandlerResult::Continue;
+    }
+
+    // The start word gets the index just past the end word and the element count, saturated at
+    // CountMask; the end word points back at the start word.
+    sJSONHandlerResult Close(sJSONTapeTag Start, sJSONTapeTag End) {
+        auto Opened = Stack.back();
+        Stack.pop_back();
+        Tape->push_back(Word(End, Opened.Start));
+
+        uint64_t Count = Opened.Count < CountMask ? Opened.Count : CountMask;
+        (*Tape)[Opened.Start] = Word(Start, Count << 32 | Tape->size());
+        return sJSONHandlerResult::Continue;
+    }
+
+    sJSONHandlerResult AppendNumber(sJSONTapeTag Tag, uint64_t Bits) {
+        CountValue();
+        Tape->push_back(Word(Tag, 0));
+        Tape->push_back(Bits);
+        return sJSONHandlerResult::Continue;
+    }
+
+    // Strings are stored as a 32-bit length, the characters and a terminating zero.
+    void AppendString(std::string_view Value) {
+        Tape->push_back(Word(sJSONTapeTag::String, Strings->size()));
+
+        uint32_t Length = static_cast<uint32_t>(Value.size());
+        Strings->append(reinterpret_cast<const char *>(&Length), sizeof(Length));
+        Strings->append(Value.data(), Value.size());
+        Strings->push_back('\0');
+    }
+
+private:
+    std::vector<uint64_t> *Tape;
+    std::string *Strings;
+    std::vector<Frame> Stack;
+};
+
+class sJSONTapeValue;
+
+// Document stored as one flat tape of 64-bit words instead of a graph of nodes. Every word carries a
+// tag in its top byte. A container is a start word holding the index past its end and its element
+// count, its contents, and an end word pointing back at the start. Object contents alternate key
+// and value. Numbers take a second word with their bits; strings point into a separate buffer.
+// Type checks are tag compares, skipping a container is one jump, and iterating reads the tape in
+// order. Unlike sJSONParser, any JSON value is accepted as the root.
+class sJSONTapeDocument {
+public:
+    sJSONTapeDocument() : Builder(Tape, Strings), Reader(std::string_view()) {
+    }
+
+    sJSONTapeDocument(const sJSONTapeDocument &) = delete;
+
+    sJSONTapeDocument &operator=(const sJSONTapeDocument &) = delete;
+
+public:
+    // Parses Code, replacing the previous content but keeping the buffers. Strings are copied into the
+    // string buffer, so Code does not have to outlive the document.
+    bool Parse(std::string_view Code) {
+        Tape.clear();
+        Strings.clear();
+        if (Tape.capacity() < Code.size() / 4) {
+            Tape.reserve(Code.size() / 4);
+            Strings.reserve(Code.size() / 2);
+        }
+
+        Reader.Reset(Code);
+        Builder.Reset();
+        Tape.push_back(0);
+        if (!Reader.Parse(Builder)) {
+            Tape.clear();
+            return false;
+        }
+
+        Tape.push_back(sJSONTapeBuilder::Word(sJSONTapeTag::Root, 0));
+        Tape[0] = sJSONTapeBuilder::Word(sJSONTapeTag::Root, Tape.size());
+        return true;
+    }
+
+    // The root value, or an empty handle when the last parse failed.
+    sJSONTapeValue GetRoot() const;
+
+    sJSONTapeValue operator[](std::string_view Key) const;
+
+    const sJSONParserStatus &GetStatus() const {
+        return Reader.GetStatus();
+    }
+
+    const std::vector<uint64_t> &GetTape() const {
+        return Tape;
+    }
+
+private:
+    friend class sJSONTapeValue;
+    friend class sJSONTapeIterator;
+    friend class sJSONWriter;
+
+    __forceinline sJSONTapeTag GetTag(size_t Index) const {
+        return static_cast<sJSONTapeTag>(Tape[Index] >> 56);
+    }
+
+    __forceinline uint64_t GetPayload(size_t Index) const {
+        return Tape[Index] & sJSONTapeBuilder::PayloadMask;
+    }
+
+    // Index of the value after the one at Index.
+    __forceinline size_t Skip(size_t Index) const {
+        switch (GetTag(Index)) {
+            case sJSONTapeTag::StartObject:
+            case sJSONTapeTag::StartArray: {
+                return static_cast<size_t>(GetPayload(Index) & 0xFFFFFFFF);
+            }
+            case sJSONTapeTag::Int64:
+            case sJSONTapeTag::UInt64:
+            case sJSONTapeTag::Double: {
+                return Index + 2;
+            }
+            default: {
+                return Index + 1;
+            }
+        }
+    }
+
+    std::string_view GetString(size_t Index) const {
+        size_t Offset = static_cast<size_t>(GetPayload(Index));
+        uint32_t Length;
+        memcpy(&Length, Strings.data() + Offset, sizeof(Length));
+
+        return std::string_view(Strings.data() + Offset + sizeof(Length), Length);
+    }
+
+private:
+    std::vector<uint64_t> Tape;
+    std::string Strings;
+    sJSONTapeBuilder Builder;
+    sJSONReader Reader;
+};
+
+class sJSONTapeIterator;
+
+// Handle to a value of an sJSONTapeDocument: the document and the tape index of the value. An empty
+// handle stands for a member or element that does not exist.
+class sJSONTapeValue {
+public:
+    sJSONTapeValue() : Document(nullptr), Index(0) {
+    }
+
+    sJSONTapeValue(const sJSONTapeDocument *Document, size_t Index) : Document(Document), Index(Index) {
+    }
+
+public:
+    sJSONTapeValue operator[](std::string_view Key) const {
+        if (!IsObject()) {
+            return sJSONTapeValue();
+        }
+
+        for (size_t Position = Index + 1; Document->GetTag(Position) != sJSONTapeTag::EndObject;) {
+            if (Document->GetString(Position) == Key) {
+                return sJSONTapeValue(Document, Position + 1);
+            }
+            Position = Document->Skip(Position + 1);
+        }
+
+        return sJSONTapeValue();
+    }
+
+    sJSONTapeValue operator[](size_t Element) const {
+        if (!IsArray()) {
+            return sJSONTapeValue();
+        }
+
+        size_t Position = Index + 1;
+        for (; Document->GetTag(Position) != sJSONTapeTag::EndArray; Position = Document->Skip(Position)) {
+            if (Element-- == 0) {
+                return sJSONTapeValue(Document, Position);
+            }
+        }
+
+        return sJSONTapeValue();
+    }
+
+    const bool IsValid() const {
+        return Document != nullptr;
+    }
+
+    const sJSONTapeTag GetTag() const {
+        return IsValid() ? Document->GetTag(Index) : sJSONTapeTag::Null;
+    }
+
+    const sJSONValueType GetType() const {
+        switch (GetTag()) {
+            case sJSONTapeTag::StartObject: {
+                return sJSONValueType::Object;
+            }
+            case sJSONTapeTag::StartArray: {
+                return sJSONValueType::Array;
+            }
+            case sJSONTapeTag::Null: {
+                return sJSONValueType::Null;
+            }
+            default: {
+                return sJSONValueType::Value;
+            }
+        }
+    }
+
+    const bool IsEmpty() const {
+        return GetTag() == sJSONTapeTag::Null;
+    }
+
+    const bool IsArray() const {
+        return GetTag() == sJSONTapeTag::StartArray;
+    }
+
+    const bool IsObject() const {
+        return GetTag() == sJSONTapeTag::StartObject;
+    }
+
+    const bool IsRealValue() const {
+        return GetType() == sJSONValueType::Value;
+    }
+
+    const bool IsString() const {
+        return GetTag() == sJSONTapeTag::String;
+    }
+
+    bool Exsits(std::string_view Key) const {
+        return operator[](Key).IsValid();
+    }
+
+    // Number of members or elements; 0 for anything else. Only very large containers are counted by
+    // walking them.
+    const size_t Size() const {
+        if (!IsObject() && !IsArray()) {
+            return 0;
+        }
+
+        size_t Count = static_cast<size_t>(Document->GetPayload(Index) >> 32);
+        if (Count < sJSONTapeBuilder::CountMask) {
+            return Count;
+        }
+
+        Count = 0;
+        size_t Position = Index + 1;
+        for (size_t End = Document->Skip(Index) - 1; Position != End; ++Count) {
+            Position = Document->Skip(IsObject() ? Position + 1 : Position);
+        }
+        return Count;
+    }
+
+    // Reads the value as Type: std::string_view, std::string, bool or an arithmetic type. A value of
+    // another kind gives Type(). Strings are views into the document.
+    template<class Type>
+    Type To() const {
+        if constexpr (std::is_same_v<Type, std::string_view>) {
+            return IsString() ? Document->GetString(Index) : std::string_view();
+        } else if constexpr (std::is_same_v<Type, std::string>) {
+            return std::string(To<std::string_view>());
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            return GetTag() == sJSONTapeTag::True;
+        } else {
+            static_assert(std::is_arithmetic_v<Type>, "sJSONTapeValue::To needs a string, bool or number type");
+
+            switch (GetTag()) {
+                case sJSONTapeTag::Int64: {
+                    return static_cast<Type>(static_cast<int64_t>(Document->Tape[Index + 1]));
+                }
+                case sJSONTapeTag::UInt64: {
+                    return static_cast<Type>(Document->Tape[Index + 1]);
+                }
+                case sJSONTapeTag::Double: {
+                    double Value;
+                    memcpy(&Value, &Document->Tape[Index + 1], sizeof(Value));
+                    return static_cast<Type>(Value);
+                }
+                default: {
+                    return Type();
+                }
+            }
+        }
+    }
+
+    // Iterates the members of an object, or the elements of an array with empty keys.
+    sJSONTapeIterator begin() const;
+
+    sJSONTapeIterator end() const;
+
+    const size_t GetIndex() const {
+        return Index;
+    }
+
+    const sJSONTapeDocument *GetDocument() const {
+        return Document;
+    }
+
+private:
+    const sJSONTapeDocument *Document;
+    size_t Index;
+};
+
+class sJSONTapeIterator {
+public:
+    using Member = std::pair<std::string_view, sJSONTapeValue>;
+
+public:
+    sJSONTapeIterator() : Document(nullptr), Position(0), IsObject(false) {
+    }
+
+    sJSONTapeIterator(const sJSONTapeDocument *Document, size_t Position, bool IsObject)
+            : Document(Document), Position(Position), IsObject(IsObject) {
+        Read();
+    }
+
+public:
+    const Member &operator*() const {
+        return Current;
+    }
+
+    const Member *operator->() const {
+        return &Current;
+    }
+
+    sJSONTapeIterator &operator++() {
+        Position = Document->Skip(Current.second.GetIndex());
+        Read();
+
+        return *this;
+    }
+
+    bool operator==(const sJSONTapeIterator &Other) const {
+        return Position == Other.Position;
+    }
+
+    bool operator!=(const sJSONTapeIterator &Other) const {
+        return Position != Other.Position;
+    }
+
+private:
+    void Read() {
+        if (Document == nullptr) {
+            return;
+        }
+
+        auto Tag = Document->GetTag(Position);
+        if (Tag == sJSONTapeTag::EndObject || Tag == sJSONTapeTag::EndArray) {
+            return;
+        }
+        if (IsObject) {
+            Current = Member(Document->GetString(Position), sJSONTapeValue(Document, Position + 1));
+        } else {
+            Current = Member(std::string_view(), sJSONTapeValue(Document, Position));
+        }
+    }
+
+private:
+    const sJSONTapeDocument *Document;
+    size_t Position;
+    bool IsObject;
+    Member Current;
+};
+
+inline sJSONTapeIterator sJSONTapeValue::begin() const {
+    if (!IsObject() && !IsArray()) {
+        return sJSONTapeIterator();
+    }
+
+    return sJSONTapeIterator(Document, Index + 1, IsObject());
+}
+
+inline sJSONTapeIterator sJSONTapeValue::end() const {
+    if (!IsObject() && !IsArray()) {
+        return sJSONTapeIterator();
+    }
+
+    return sJSONTapeIterator(Document, Document->Skip(Index) - 1, IsObject());
+}
+
+inline sJSONTapeValue sJSONTapeDocument::GetRoot() const {
+    return Tape.empty() ? sJSONTapeValue() : sJSONTapeValue(this, 1);
+}
+
+inline sJSONTapeValue sJSONTapeDocument::operator[](std::string_view Key) const {
+    return GetRoot()[Key];
+}
+
+// Fixed set of threads running parallel loops. Every worker owns a slice of the loop and, once that
+// runs dry, steals the back half of another worker's slice. The calling thread takes part as worker 0.
+class sJSONThreadPool {
+public:
+    explicit sJSONThreadPool(size_t ThreadCount = std::thread::hardware_concurrency())
+            : WorkerCount(ThreadCount == 0 ? 1 : ThreadCount), Ranges(new WorkerRange[WorkerCount]),
+              Generation(0), Running(0), Stopping(false), Body(nullptr) {
+        for (size_t Worker = 1; Worker < WorkerCount; ++Worker) {
+            Threads.emplace_back([this, Worker]() { Loop(Worker); });
+        }
+    }
+
+    sJSONThreadPool(const sJSONThreadPool &) = delete;
+
+    sJSONThreadPool &operator=(const sJSONThreadPool &) = delete;
+
+    ~sJSONThreadPool() {
+        {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Stopping = true;
+        }
+        Wake.notify_all();
+        for (auto &Thread : Threads) {
+            Thread.join();
+        }
+    }
+
+public:
+    const size_t GetWorkerCount() const {
+        return WorkerCount;
+    }
+
+    // Calls Function(Index, Worker) for every Index in [0, Count) and returns when all calls are done.
+    // Calls running at the same time never share a Worker, so it can select per-thread state.
+    void ParallelFor(size_t Count, const std::function<void(size_t, size_t)> &Function) {
+        if (Count == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> CallGuard(CallLock);
+        std::unique_lock<std::mutex> Guard(Lock);
+        for (size_t Worker = 0; Worker < WorkerCount; ++Worker) {
+            std::lock_guard<std::mutex> RangeGuard(Ranges[Worker].Lock);
+            Ranges[Worker].Begin = Count * Worker / WorkerCount;
+            Ranges[Worker].End = Count * (Worker + 1) / WorkerCount;
+        }
+        Body = &Function;
+        Running = WorkerCount - 1;
+        ++Generation;
+        Guard.unlock();
+        Wake.notify_all();
+
+        Work(0);
+
+        Guard.lock();
+        Done.wait(Guard, [this]() { return Running == 0; });
+        Body = nullptr;
+    }
+
+private:
+    struct alignas(64) WorkerRange {
+        std::mutex Lock;
+        size_t Begin = 0;
+        size_t End = 0;
+    };
+
+private:
+    void Loop(size_t Worker) {
+        size_t Seen = 0;
+        std::unique_lock<std::mutex> Guard(Lock);
+        while (true) {
+            Wake.wait(Guard, [&]() { return Stopping || Generation != Seen; });
+            if (Stopping) {
+                return;
+            }
+
+            Seen = Generation;
+            Guard.unlock();
+            Work(Worker);
+            Guard.lock();
+            if (--Running == 0) {
+                Done.notify_one();
+            }
+        }
+    }
+
+    void Work(size_t Worker) {
+        size_t Index;
+        while (Pop(Worker, Index) || Steal(Worker, Index)) {
+            (*Body)(Index, Worker);
+        }
+    }
+
+    bool Pop(size_t Worker, size_t &Index) {
+        auto &Range = Ranges[Worker];
+        std::lock_guard<std::mutex> Guard(Range.Lock);
+        if (Range.Begin == Range.End) {
+            return false;
+        }
+
+        Index = Range.Begin++;
+        return true;
+    }
+
+    bool Steal(size_t Worker, size_t &Index) {
+        for (size_t Offset = 1; Offset < WorkerCount; ++Offset) {
+            auto &Victim = Ranges[(Worker + Offset) % WorkerCount];
+            size_t Begin;
+            size_t End;
+            {
+                std::lock_guard<std::mutex> Guard(Victim.Lock);
+                size_t Left = Victim.End - Victim.Begin;
+                if (Left == 0) {
+                    continue;
+                }
+
+                End = Victim.End;
+                Begin = End - (Left + 1) / 2;
+                Victim.End = Begin;
+            }
+
+            auto &Range = Ranges[Worker];
+            std::lock_guard<std::mutex> Guard(Range.Lock);
+            Range.Begin = Begin + 1;
+            Range.End = End;
+            Index = Begin;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    size_t WorkerCount;
+    std::unique_ptr<WorkerRange[]> Ranges;
+    std::vector<std::thread> Threads;
+    std::mutex CallLock;
+    std::mutex Lock;
+    std::condition_variable Wake;
+    std::condition_variable Done;
+    size_t Generation;
+    size_t Running;
+    bool Stopping;
+    const std::function<void(size_t, size_t)> *Body;
+};
+
+struct sJSONBatchRecord {
+    // 1-based line of the record within the batch input.
+    size_t Line;
+    std::string_view Text;
+    sJSONObject *Object;
+    sJSONParserStatus Status;
+
+    sJSONRootNode GetRoot() const {
+        return sJSONRootNode(Object);
+    }
+};
+
+// Parses newline-delimited JSON (JSON Lines), one object per line, on a thread pool. The input is cut
+// into chunks on line boundaries and each worker builds its records in its own document, so workers
+// never share an allocator. A bad line only fails its own record.
+class sJSONBatchParser {
+public:
+    static constexpr size_t MinimumChunkSize = 64 * 1024;
+
+public:
+    explicit sJSONBatchParser(size_t ThreadCount = std::thread::hardware_concurrency())
+            : Pool(ThreadCount), KeyPool(nullptr) {
+        for (size_t Worker = 0; Worker < Pool.GetWorkerCount(); ++Worker) {
+            Workers.emplace_back(new WorkerState);
+        }
+    }
+
+public:
+    // Parses every non-blank line of Input and returns the records in input order. They stay valid
+    // until the next call; with sJSONInputMode::Reference they also point into Input.
+    const std::vector<sJSONBatchRecord> &Parse(std::string_view Input, sJSONInputMode Mode = sJSONInputMode::Copy) {
+        for (auto &Worker : Workers) {
+            Worker->Document.Reset();
+        }
+
+        size_t ChunkSize = Input.size() / (Pool.GetWorkerCount() * 8);
+        if (ChunkSize < MinimumChunkSize) {
+            ChunkSize = MinimumChunkSize;
+        }
+        size_t ChunkCount = (Input.size() + ChunkSize - 1) / ChunkSize;
+        Chunks.resize(ChunkCount);
+        Pool.ParallelFor(ChunkCount, [&](size_t Chunk, size_t Worker) {
+            size_t End = (Chunk + 1) * ChunkSize;
+            ParseChunk(Input, Mode, Chunk * ChunkSize, End < Input.size() ? End : Input.size(), Chunks[Chunk],
+                       *Workers[Worker]);
+        });
+
+        Records.clear();
+        size_t Line = 0;
+        for (auto &Chunk : Chunks) {
+            for (auto &Record : Chunk.Records) {
+                Record.Line += Line;
+                Records.push_back(std::move(Record));
+            }
+            Line += Chunk.Lines;
+        }
+
+        return Records;
+    }
+
+    const std::vector<sJSONBatchRecord> &GetRecords() const {
+        return Records;
+    }
+
+    // Takes keys from Pool instead of copying them into every worker's document. Pool must outlive
+    // the records.
+    void SetKeyPool(sJSONKeyPool *Pool) {
+        KeyPool = Pool;
+    }
+
+private:
+    struct WorkerState {
+        WorkerState() : Reader(std::string_view()) {
+        }
+
+        sJSONDocument Document;
+        sJSONReader Reader;
+    };
+
+    struct ChunkResult {
+        std::vector<sJSONBatchRecord> Records;
+        size_t Lines;
+    };
+
+private:
+    // Parses the lines starting inside [Begin, End). A line that crosses End is finished here and
+    // skipped by the next chunk.
+    void ParseChunk(std::string_view Input, sJSONInputMode Mode, size_t Begin, size_t End, ChunkResult &Result,
+                    WorkerState &Worker) {
+        Result.Records.clear();
+        Result.Lines = 0;
+
+        size_t Position = Begin;
+        if (Position != 0) {
+            auto NewLine = static_cast<const char *>(memchr(Input.data() + Position - 1, '\n', End - Position + 1));
+            if (NewLine == nullptr) {
+                return;
+            }
+            Position = NewLine - Input.data() + 1;
+        }
+
+        sJSONTreeBuilder Builder(Worker.Document, nullptr, Input, Mode, KeyPool);
+        while (Position < End) {
+            auto NewLine = static_cast<const char *>(memchr(Input.data() + Position, '\n', Input.size() - Position));
+            size_t LineEnd = NewLine != nullptr ? NewLine - Input.data() : Input.size();
+            auto Text = Input.substr(Position, LineEnd - Position);
+            Position = LineEnd + 1;
+            ++Result.Lines;
+
+            if (!Text.empty() && Text.back() == '\r') {
+                Text.remove_suffix(1);
+            }
+            if (Text.find_first_not_of(" \t") == std::string_view::npos) {
+                continue;
+            }
+
+            sJSONBatchRecord Record{Result.Lines, Text, Worker.Document.CreateObject(), sJSONParserStatus()};
+            Worker.Reader.Reset(Text);
+            Builder.Reset(Record.Object);
+            Worker.Reader.Parse(Builder);
+            if (Builder.IsBadRoot()) {
+                Worker.Reader.PushUnknownToken();
+            }
+            Record.Status.ErrorInfo.swap(Worker.Reader.GetStatus().ErrorInfo);
+
+            Result.Records.push_back(std::move(Record));
+        }
+    }
+
+private:
+    sJSONThreadPool Pool;
+    std::vector<std::unique_ptr<WorkerState>> Workers;
+    std::vector<ChunkResult> Chunks;
+    std::vector<sJSONBatchRecord> Records;
+    sJSONKeyPool *KeyPool;
+};
+
+// Parses one large document on a thread pool when most of it is a single array, for example an object
+// holding millions of records. The input is cut where the array's own commas are, each piece is parsed
+// as a list of elements by a worker, and the pieces are joined in order into the array of a tree built
+// from the rest of the document. The result matches a sequential parse; documents that cannot be split
+// are parsed sequentially.
+class sJSONParallelParser {
+public:
+    static constexpr size_t MinimumSize = 1024 * 1024;
+
+public:
+    explicit sJSONParallelParser(size_t ThreadCount = std::thread::hardware_concurrency())
+            : Pool(ThreadCount), Reader(std::string_view()), KeyPool(nullptr), PieceCount(0) {
+        for (size_t Worker = 0; Worker < Pool.GetWorkerCount(); ++Worker) {
+            Workers.emplace_back(new WorkerState);
+        }
+    }
+
+public:
+    // The tree stays valid until the next call; with sJSONInputMode::Reference it also points into Code.
+    sJSONRootNode Parse(std::string_view Code, sJSONInputMode Mode = sJSONInputMode::Copy) {
+        PieceCount = 0;
+        Status.ErrorInfo.clear();
+        for (auto &Worker : Workers) {
+            Worker->Document.Reset();
+        }
+
+        if (Code.size() >= MinimumSize && Pool.GetWorkerCount() > 1 && Split(Code) && ParsePieces(Code, Mode)) {
+            PieceCount = Pieces.size();
+            return sJSONRootNode(Document.GetRootObject());
+        }
+
+        sJSONParser Parser(Code, Mode);
+        Parser.SetKeyPool(KeyPool);
+        auto Root = Parser.Parse(Document);
+        Status = Parser.GetStatus();
+
+        return Root;
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+    // Number of pieces the last document was parsed in, 0 when it was parsed sequentially.
+    const size_t GetPieceCount() const {
+        return PieceCount;
+    }
+
+    // Takes keys from Pool instead of copying them into the documents. Pool must outlive the tree.
+    void SetKeyPool(sJSONKeyPool *Pool) {
+        KeyPool = Pool;
+    }
+
+private:
+    struct WorkerState {
+        WorkerState() : Reader(std::string_view()) {
+        }
+
+        sJSONDocument Document;
+        sJSONReader Reader;
+    };
+
+    struct ChunkState {
+        size_t Begin;
+        bool InString;
+        std::ptrdiff_t Depth;
+        std::ptrdiff_t Lowest;
+    };
+
+    struct Piece {
+        size_t Begin;
+        size_t End;
+        sJSONArray *Array;
+        bool Failed;
+    };
+
+    // Builds the document with the split array left empty, and remembers that array.
+    class SkeletonBuilder : public sJSONTreeBuilder {
+    public:
+        SkeletonBuilder(sJSONDocument &Target, std::string_view Input, sJSONInputMode Mode, sJSONKeyPool *KeyPool,
+                        const sJSONReader &Reader, size_t Offset)
+                : sJSONTreeBuilder(Target, Target.GetRootObject(), Input, Mode, KeyPool), Reader(&Reader),
+                  Offset(Offset), Array(nullptr) {
+        }
+
+    public:
+        sJSONHandlerResult StartArray() override {
+            auto Result = sJSONTreeBuilder::StartArray();
+            if (Result == sJSONHandlerResult::Continue && Reader->GetPosition() == Offset) {
+                Array = static_cast<sJSONArray *>(GetOpenContainer());
+            }
+
+            return Result;
+        }
+
+        sJSONArray *GetArray() const {
+            return Array;
+        }
+
+    private:
+        const sJSONReader *Reader;
+        size_t Offset;
+        sJSONArray *Array;
+    };
+
+private:
+    // Calls Visit(Offset, Character) for the brackets and commas of Code[Begin, End) that are outside of
+    // strings until it returns false. Returns whether End lies inside a string.
+    template<class Visitor>
+    static bool Walk(std::string_view Code, size_t Begin, size_t End, bool InString, Visitor &&Visit) {
+        size_t Backslashes = 0;
+        while (Backslashes < Begin && Code[Begin - Backslashes - 1] == '\\') {
+            ++Backslashes;
+        }
+
+        sJSONStructuralIndexer Indexer(Code.substr(Begin, End - Begin));
+        Indexer.Seed(InString, Backslashes % 2 != 0);
+        std::vector<size_t> Positions;
+        while (Indexer.Next(Positions)) {
+            for (auto Position : Positions) {
+                char Character = Code[Begin + Position];
+                if (Character != '\"' && !Visit(Begin + Position, Character)) {
+                    return false;
+                }
+            }
+        }
+
+        return Indexer.InString();
+    }
+
+    // Finds the array that stays open across the whole middle of Code and the commas to cut it at.
+    bool Split(std::string_view Code) {
+        size_t Count = Pool.GetWorkerCount() * 4;
+        Chunks.resize(Count);
+        for (size_t Chunk = 0; Chunk < Count; ++Chunk) {
+            Chunks[Chunk].Begin = Code.size() * Chunk / Count;
+        }
+        auto ChunkEnd = [&](size_t Chunk) { return Chunk + 1 < Count ? Chunks[Chunk + 1].Begin : Code.size(); };
+
+        // Whether a chunk starts inside a string only depends on the parity of the quotes before it.
+        Pool.ParallelFor(Count, [&](size_t Chunk, size_t) {
+            Chunks[Chunk].InString = Walk(Code, Chunks[Chunk].Begin, ChunkEnd(Chunk), false,
+                                          [](size_t, char) { return true; });
+        });
+        bool InString = false;
+        for (auto &Chunk : Chunks) {
+            bool Odd = Chunk.InString;
+            Chunk.InString = InString;
+            InString = InString != Odd;
+        }
+
+        Pool.ParallelFor(Count, [&](size_t Chunk, size_t) {
+            std::ptrdiff_t Depth = 0;
+            std::ptrdiff_t Lowest = 0;
+            Walk(Code, Chunks[Chunk].Begin, ChunkEnd(Chunk), Chunks[Chunk].InString, [&](size_t, char Character) {
+                if (Character == '{' || Character == '[') {
+                    ++Depth;
+                } else if (Character == '}' || Character == ']') {
+                    Lowest = --Depth < Lowest ? Depth : Lowest;
+                }
+                return true;
+            });
+            Chunks[Chunk].Depth = Depth;
+            Chunks[Chunk].Lowest = Lowest;
+        });
+
+        // Chunks[i].Depth becomes the depth at the start of chunk i. The container at the lowest depth
+        // seen between the first and the last cut is open across all cuts.
+        std::ptrdiff_t Depth = 0;
+        std::ptrdiff_t Level = std::numeric_limits<std::ptrdiff_t>::max();
+        for (size_t Chunk = 0; Chunk < Count; ++Chunk) {
+            std::ptrdiff_t Delta = Chunks[Chunk].Depth;
+            Chunks[Chunk].Depth = Depth;
+            if (Chunk != 0 && Chunk + 1 < Count && Depth + Chunks[Chunk].Lowest < Level) {
+                Level = Depth + Chunks[Chunk].Lowest;
+            }
+            Depth += Delta;
+        }
+        if (Chunks[Count - 1].Depth < Level) {
+            Level = Chunks[Count - 1].Depth;
+        }
+        if (Level <= 0) {
+            return false;
+        }
+
+        // Task 0 finds the bracket opening the array, task Count the one closing it and the others the
+        // first comma of the array after the start of their chunk.
+        std::vector<size_t> Cuts(Count + 1, std::string_view::npos);
+        Pool.ParallelFor(Count + 1, [&](size_t Task, size_t) {
+            size_t Chunk = Task == 0 ? 0 : (Task < Count ? Task : Count - 1);
+            std::ptrdiff_t Depth = Chunks[Chunk].Depth;
+            size_t End = Task == 0 ? ChunkEnd(0) : Code.size();
+            Walk(Code, Chunks[Chunk].Begin, End, Chunks[Chunk].InString, [&](size_t Offset, char Character) {
+                if (Character == '{' || Character == '[') {
+                    if (++Depth == Level && Task == 0) {
+                        Cuts[Task] = Offset;
+                    }
+                } else if (Character == '}' || Character == ']') {
+                    if (Depth-- == Level && Task != 0) {
+                        if (Task == Count) {
+                            Cuts[Task] = Offset;
+                        }
+                        return false;
+                    }
+                } else if (Character == ',' && Depth == Level && Task != 0 && Task != Count) {
+                    Cuts[Task] = Offset;
+                    return false;
+                }
+                return true;
+            });
+        });
+
+        size_t Opener = Cuts[0];
+        size_t Closer = Cuts[Count];
+        if (Opener == std::string_view::npos || Closer == std::string_view::npos || Code[Opener] != '[') {
+            return false;
+        }
+
+        Pieces.clear();
+        size_t Begin = Opener + 1;
+        for (size_t Task = 1; Task < Count; ++Task) {
+            if (Cuts[Task] != std::string_view::npos && Cuts[Task] > Begin && Cuts[Task] < Closer) {
+                Pieces.push_back({Begin, Cuts[Task], nullptr, false});
+                Begin = Cuts[Task] + 1;
+            }
+        }
+        if (Pieces.empty()) {
+            return false;
+        }
+        Pieces.push_back({Begin, Closer, nullptr, false});
+
+        Skeleton.assign(Code.data(), Opener + 1);
+        Skeleton.append(Code.data() + Closer, Code.size() - Closer);
+        SkeletonOffset = Opener + 1;
+
+        return true;
+    }
+
+    // Parses the pieces and the rest of the document side by side, then joins the pieces.
+    bool ParsePieces(std::string_view Code, sJSONInputMode Mode) {
+        Document.Reset();
+        Reader.Reset(Skeleton);
+        SkeletonBuilder Builder(Document, Code, Mode, KeyPool, Reader, SkeletonOffset);
+        bool SkeletonFailed = false;
+
+        Pool.ParallelFor(Pieces.size() + 1, [&](size_t Task, size_t Worker) {
+            if (Task == Pieces.size()) {
+                SkeletonFailed = !Reader.Parse(Builder) || Builder.GetArray() == nullptr;
+                return;
+            }
+
+            auto &Piece = Pieces[Task];
+            auto &State = *Workers[Worker];
+            Piece.Array = State.Document.CreateArray();
+            State.Reader.Reset(Code.substr(Piece.Begin, Piece.End - Piece.Begin));
+
+            sJSONTreeBuilder PieceBuilder(State.Document, nullptr, Code, Mode, KeyPool);
+            PieceBuilder.ResetElements(Piece.Array);
+            Piece.Failed = !State.Reader.ParseElements(PieceBuilder);
+            PieceBuilder.FinishElements();
+        });
+
+        if (SkeletonFailed) {
+            return false;
+        }
+        size_t Size = 0;
+        for (auto &Piece : Pieces) {
+            if (Piece.Failed) {
+                return false;
+            }
+            Size += Piece.Array->ValueSet.size();
+        }
+
+        auto &ValueSet = Builder.GetArray()->ValueSet;
+        ValueSet.reserve(Size);
+        for (auto &Piece : Pieces) {
+            ValueSet.insert(ValueSet.end(), Piece.Array->ValueSet.begin(), Piece.Array->ValueSet.end());
+        }
+
+        return true;
+    }
+
+private:
+    sJSONThreadPool Pool;
+    std::vector<std::unique_ptr<WorkerState>> Workers;
+    sJSONDocument Document;
+    sJSONReader Reader;
+    sJSONParserStatus Status;
+    sJSONKeyPool *KeyPool;
+    std::vector<ChunkState> Chunks;
+    std::vector<Piece> Pieces;
+    std::string Skeleton;
+    size_t SkeletonOffset;
+    size_t PieceCount;
+};
+
+class sJSONStringSink {
+public:
+    sJSONStringSink() = default;
+
+    explicit sJSONStringSink(size_t Capacity) {
+        Buffer.reserve(Capacity);
+    }
+
+public:
+    __forceinline void Write(const char *Data, size_t Size) {
+        Buffer.append(Data, Size);
+    }
+
+    __forceinline void Put(char Character) {
+        Buffer.push_back(Character);
+    }
+
+    void Reserve(size_t Capacity) {
+        Buffer.reserve(Capacity);
+    }
+
+    std::string &GetString() {
+        return Buffer;
+    }
+
+    std::string Release() {
+        return std::move(Buffer);
+    }
+
+private:
+    std::string Buffer;
+};
+
+// Collects output in a fixed-size buffer and hands it to Drain() whenever it fills up. Derived sinks
+// must call Flush() from their destructor.
+class sJSONBufferedSink {
+public:
+    static constexpr size_t BufferSize = 16 * 1024;
+
+public:
+    sJSONBufferedSink() : Used(0), Failed(false) {
+    }
+
+    sJSONBufferedSink(const sJSONBufferedSink &) = delete;
+
+    sJSONBufferedSink &operator=(const sJSONBufferedSink &) = delete;
+
+    virtual ~sJSONBufferedSink() = default;
+
+public:
+    __forceinline void Write(const char *Data, size_t Size) {
+        if (Size > BufferSize - Used) {
+            Flush();
+            if (Size >= BufferSize) {
+                Failed = !Drain(Data, Size) || Failed;
+                return;
+            }
+        }
+
+        memcpy(Buffer + Used, Data, Size);
+        Used += Size;
+    }
+
+    __forceinline void Put(char Character) {
+        if (Used == BufferSize) {
+            Flush();
+        }
+
+        Buffer[Used++] = Character;
+    }
+
+    void Flush() {
+        if (Used != 0) {
+            Failed = !Drain(Buffer, Used) || Failed;
+            Used = 0;
+        }
+    }
+
+    const bool IsFailed() const {
+        return Failed;
+    }
+
+protected:
+    virtual bool Drain(const char *Data, size_t Size) = 0;
+
+private:
+    char Buffer[BufferSize];
+    size_t Used;
+    bool Failed;
+};
+
+class sJSONFileSink : public sJSONBufferedSink {
+public:
+    sJSONFileSink(FILE *File) : File(File) {
+    }
+
+    ~sJSONFileSink() override {
+        Flush();
+    }
+
+protected:
+    bool Drain(const char *Data, size_t Size) override {
+        return fwrite(Data, 1, Size, File) == Size;
+    }
+
+private:
+    FILE *File;
+};
+
+class sJSONDescriptorSink : public sJSONBufferedSink {
+public:
+    sJSONDescriptorSink(int FileDescriptor) : FileDescriptor(FileDescriptor) {
+    }
+
+    ~sJSONDescriptorSink() override {
+        Flush();
+    }
+
+protected:
+    bool Drain(const char *Data, size_t Size) override {
+        while (Size != 0) {
+#ifdef _WIN32
+            auto Written = _write(FileDescriptor, Data, static_cast<unsigned int>(Size));
+#else
+            auto Written = write(FileDescriptor, Data, Size);
+#endif
+            if (Written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return false;
+            }
+
+            Data += Written;
+            Size -= static_cast<size_t>(Written);
+        }
+
+        return true;
+    }
+
+private:
+    int FileDescriptor;
+};
+
+class sJSONCallbackSink : public sJSONBufferedSink {
+public:
+    sJSONCallbackSink(std::function<bool(std::string_view)> Callback) : Callback(std::move(Callback)) {
+    }
+
+    ~sJSONCallbackSink() override {
+        Flush();
+    }
+
+protected:
+    bool Drain(const char *Data, size_t Size) override {
+        return Callback(std::string_view(Data, Size));
+    }
+
+private:
+    std::function<bool(std::string_view)> Callback;
+};
+
+// Describes the JSON members of a struct. Specialize it with sJSON_MAPPING(Type, Member...) at global
+// scope; every listed member is read and written under its own name.
+template<class Type>
+struct sJSONMapping;
+
+template<class Class, class Member>
+struct sJSONField {
+    std::string_view Name;
+    Member Class::*Pointer;
+};
+
+template<class Class, class Member>
+constexpr sJSONField<Class, Member> sJSONMakeField(std::string_view Name, Member Class::*Pointer) {
+    return {Name, Pointer};
+}
+
+#define sJSON_EXPAND(X) X
+#define sJSON_FIELD(Type, Member) sJSONMakeField(#Member, &Type::Member)
+#define sJSON_FIELDS_1(Type, Member) sJSON_FIELD(Type, Member)
+#define sJSON_FIELDS_2(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_1(Type, __VA_ARGS__))
+#define sJSON_FIELDS_3(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_2(Type, __VA_ARGS__))
+#define sJSON_FIELDS_4(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_3(Type, __VA_ARGS__))
+#define sJSON_FIELDS_5(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_4(Type, __VA_ARGS__))
+#define sJSON_FIELDS_6(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_5(Type, __VA_ARGS__))
+#define sJSON_FIELDS_7(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_6(Type, __VA_ARGS__))
+#define sJSON_FIELDS_8(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_7(Type, __VA_ARGS__))
+#define sJSON_FIELDS_9(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_8(Type, __VA_ARGS__))
+#define sJSON_FIELDS_10(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_9(Type, __VA_ARGS__))
+#define sJSON_FIELDS_11(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_10(Type, __VA_ARGS__))
+#define sJSON_FIELDS_12(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_11(Type, __VA_ARGS__))
+#define sJSON_FIELDS_13(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_12(Type, __VA_ARGS__))
+#define sJSON_FIELDS_14(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_13(Type, __VA_ARGS__))
+#define sJSON_FIELDS_15(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_14(Type, __VA_ARGS__))
+#define sJSON_FIELDS_16(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_15(Type, __VA_ARGS__))
+#define sJSON_FIELDS_17(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_16(Type, __VA_ARGS__))
+#define sJSON_FIELDS_18(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_17(Type, __VA_ARGS__))
+#define sJSON_FIELDS_19(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_18(Type, __VA_ARGS__))
+#define sJSON_FIELDS_20(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_19(Type, __VA_ARGS__))
+#define sJSON_FIELDS_21(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_20(Type, __VA_ARGS__))
+#define sJSON_FIELDS_22(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_21(Type, __VA_ARGS__))
+#define sJSON_FIELDS_23(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_22(Type, __VA_ARGS__))
+#define sJSON_FIELDS_24(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_23(Type, __VA_ARGS__))
+#define sJSON_FIELDS_25(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_24(Type, __VA_ARGS__))
+#define sJSON_FIELDS_26(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_25(Type, __VA_ARGS__))
+#define sJSON_FIELDS_27(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_26(Type, __VA_ARGS__))
+#define sJSON_FIELDS_28(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_27(Type, __VA_ARGS__))
+#define sJSON_FIELDS_29(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_28(Type, __VA_ARGS__))
+#define sJSON_FIELDS_30(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_29(Type, __VA_ARGS__))
+#define sJSON_FIELDS_31(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_30(Type, __VA_ARGS__))
+#define sJSON_FIELDS_32(Type, Member, ...) sJSON_FIELD(Type, Member), sJSON_EXPAND(sJSON_FIELDS_31(Type, __VA_ARGS__))
+#define sJSON_PICK_FIELDS(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, \
+        _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, Name, ...) Name
+#define sJSON_FIELDS(Type, ...) \
+    sJSON_EXPAND(sJSON_PICK_FIELDS(__VA_ARGS__, sJSON_FIELDS_32, sJSON_FIELDS_31, sJSON_FIELDS_30, \
+        sJSON_FIELDS_29, sJSON_FIELDS_28, sJSON_FIELDS_27, sJSON_FIELDS_26, sJSON_FIELDS_25, sJSON_FIELDS_24, \
+        sJSON_FIELDS_23, sJSON_FIELDS_22, sJSON_FIELDS_21, sJSON_FIELDS_20, sJSON_FIELDS_19, sJSON_FIELDS_18, \
+        sJSON_FIELDS_17, sJSON_FIELDS_16, sJSON_FIELDS_15, sJSON_FIELDS_14, sJSON_FIELDS_13, sJSON_FIELDS_12, \
+        sJSON_FIELDS_11, sJSON_FIELDS_10, sJSON_FIELDS_9, sJSON_FIELDS_8, sJSON_FIELDS_7, sJSON_FIELDS_6, \
+        sJSON_FIELDS_5, sJSON_FIELDS_4, sJSON_FIELDS_3, sJSON_FIELDS_2, sJSON_FIELDS_1)(Type, __VA_ARGS__))
+#define sJSON_MAPPING(Type, ...)                                                         \
+    template<>                                                                           \
+    struct sJSONMapping<Type> {                                                          \
+        static constexpr auto Fields = std::make_tuple(sJSON_FIELDS(Type, __VA_ARGS__)); \
+    }
+
+template<class Type, class = void>
+struct sJSONIsMapped : std::false_type {};
+
+template<class Type>
+struct sJSONIsMapped<Type, std::void_t<decltype(sJSONMapping<Type>::Fields)>> : std::true_type {};
+
+template<class Type>
+struct sJSONIsVector : std::false_type {};
+
+template<class Type, class Allocator>
+struct sJSONIsVector<std::vector<Type, Allocator>> : std::true_type {};
+
+template<class Type>
+struct sJSONIsOptional : std::false_type {};
+
+template<class Type>
+struct sJSONIsOptional<std::optional<Type>> : std::true_type {};
+
+constexpr size_t sJSONFieldSlot(uint64_t Hash, uint64_t Seed, size_t Bits) {
+    return static_cast<size_t>(((Hash ^ Seed) * 0x9E3779B97F4A7C15ULL) >> (64 - Bits));
+}
+
+// Searches for a seed under which every name gets its own slot.
+template<size_t Count, size_t Bits>
+constexpr uint64_t sJSONFindFieldSeed(const std::array<std::string_view, Count> &Names) {
+    for (uint64_t Seed = 0; Seed < 65536; ++Seed) {
+        bool Used[size_t(1) << Bits] = {};
+        bool Perfect = true;
+        for (size_t Index = 0; Index < Count && Perfect; ++Index) {
+            size_t Slot = sJSONFieldSlot(sJSONHashKey(Names[Index]), Seed, Bits);
+            Perfect = !Used[Slot];
+            Used[Slot] = true;
+        }
+        if (Perfect) {
+            return Seed;
+        }
+    }
+
+    return ~0ULL;
+}
+
+template<size_t Count, size_t Bits>
+constexpr std::array<uint8_t, size_t(1) << Bits> sJSONBuildFieldSlots(const std::array<std::string_view, Count> &Names,
+                                                                      uint64_t Seed) {
+    std::array<uint8_t, size_t(1) << Bits> Slots = {};
+    for (auto &Slot : Slots) {
+        Slot = static_cast<uint8_t>(Count);
+    }
+    for (size_t Index = 0; Index < Count; ++Index) {
+        Slots[sJSONFieldSlot(sJSONHashKey(Names[Index]), Seed, Bits)] = static_cast<uint8_t>(Index);
+    }
+
+    return Slots;
+}
+
+// Perfect hash from the member names of a mapped struct to field indices, built at compile time, so a
+// key is found with one hash, one probe and one comparison.
+template<class Type>
+class sJSONFieldTable {
+public:
+    static constexpr size_t Count = std::tuple_size_v<std::decay_t<decltype(sJSONMapping<Type>::Fields)>>;
+    static_assert(Count < 64, "sJSON_MAPPING supports at most 63 members");
+
+    static constexpr std::array<std::string_view, Count> Names = std::apply(
+            [](const auto &...Fields) { return std::array<std::string_view, Count>{Fields.Name...}; },
+            sJSONMapping<Type>::Fields);
+
+public:
+    // Index of the member called Key, or Count.
+    static __forceinline size_t Find(std::string_view Key) {
+        size_t Index = Slots[sJSONFieldSlot(sJSONHashKey(Key), Seed, Bits)];
+        return Index != Count && Names[Index] == Key ? Index : Count;
+    }
+
+    // Calls Visit(Field) for the field at Index and returns its result.
+    template<class Visitor>
+    static bool Visit(size_t Index, Visitor &&Function) {
+        return Visit(Index, Function, std::make_index_sequence<Count>());
+    }
+
+private:
+    template<class Visitor, size_t... Indices>
+    static bool Visit(size_t Index, Visitor &Function, std::index_sequence<Indices...>) {
+        bool Result = true;
+        ((Index == Indices && (Result = Function(std::get<Indices>(sJSONMapping<Type>::Fields)), true)) || ...);
+
+        return Result;
+    }
+
+    static constexpr size_t SlotBits() {
+        size_t Bits = 2;
+        while ((size_t(1) << Bits) < Count * 4) {
+            ++Bits;
+        }
+
+        return Bits;
+    }
+
+private:
+    static constexpr size_t Bits = SlotBits();
+    static constexpr uint64_t Seed = sJSONFindFieldSeed<Count, Bits>(Names);
+    static_assert(Seed != ~0ULL, "sJSON_MAPPING members need distinct names");
+    static constexpr std::array<uint8_t, size_t(1) << Bits> Slots = sJSONBuildFieldSlots<Count, Bits>(Names, Seed);
+};
+
+// Parses JSON straight into mapped structs, std::vector, std::optional, std::string, bool and numbers,
+// without building a tree. Unknown members are skipped and missing ones keep their value; of repeated
+// members the first one wins, as in the tree.
+class sJSONStructReader {
+public:
+    sJSONStructReader(std::string_view Code, sJSONSIMDLevel Level = sJSONActiveSIMDLevel)
+            : Lexer(Code, &Status, Level) {
+    }
+
+public:
+    template<class Type>
+    bool Read(Type &Target) {
+        if (!ReadValue(Target, Lexer())) {
+            return false;
+        }
+
+        auto Token = Lexer();
+        return Token.Type == sJSONTokenType::End || Fail(Token);
+    }
+
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
+    }
+
+private:
+    template<class Type>
+    bool ReadValue(Type &Target, const sJSONToken &Token) {
+        if constexpr (sJSONIsMapped<Type>::value) {
+            return ReadObject(Target, Token);
+        } else if constexpr (sJSONIsVector<Type>::value) {
+            if (Token.Type != sJSONTokenType::MiddleLeft) {
+                return Fail(Token);
+            }
+
+            Target.clear();
+            auto Next = Lexer();
+            if (Next.Type == sJSONTokenType::MiddleRight) {
+                return true;
+            }
+            while (true) {
+                Target.emplace_back();
+                if (!ReadValue(Target.back(), Next)) {
+                    return false;
+                }
+
+                Next = Lexer();
+                if (Next.Type == sJSONTokenType::MiddleRight) {
+                    return true;
+                }
+                if (Next.Type != sJSONTokenType::Comma) {
+                    return Fail(Next);
+                }
+                Next = Lexer();
+            }
+        } else if constexpr (sJSONIsOptional<Type>::value) {
+            if (Token.Type == sJSONTokenType::Null) {
+                Target.reset();
+                return true;
+            }
+
+            Target.emplace();
+            return ReadValue(*Target, Token);
+        } else if constexpr (std::is_same_v<Type, std::string>) {
+            if (Token.Type != sJSONTokenType::string) {
+                return Fail(Token);
+            }
+
+            auto Raw = Lexer.GetText(Token);
+            if (!Token.Escaped) {
+                Target.assign(Raw.data(), Raw.size());
+                return true;
+            }
+
+            Target.resize(Raw.size());
+            size_t Size = sJSONDecodeString(Raw, Target.data());
+            if (Size == sJSONBadString) {
+                Status.ErrorInfo.push_back("<Bad string>");
+                return false;
+            }
+            Target.resize(Size);
+            return true;
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            if (Token.Type != sJSONTokenType::Boolean) {
+                return Fail(Token);
+            }
+
+            Target = Lexer.GetText(Token) == "true";
+            return true;
+        } else {
+            static_assert(std::is_arithmetic_v<Type>, "sJSONStructReader cannot read this member type");
+            return ReadNumber(Target, Token);
+        }
+    }
+
+    template<class Type>
+    bool ReadObject(Type &Target, const sJSONToken &Token) {
+        using Table = sJSONFieldTable<Type>;
+        if (Token.Type != sJSONTokenType::BigLeft) {
+            return Fail(Token);
+        }
+
+        uint64_t Seen = 0;
+        auto Next = Lexer();
+        if (Next.Type == sJSONTokenType::BigRight) {
+            return true;
+        }
+        while (true) {
+            if (Next.Type != sJSONTokenType::string) {
+                return Fail(Next);
+            }
+
+            std::string_view Key;
+            if (!DecodeKey(Next, Key)) {
+                return false;
+            }
+
+            size_t Index = Table::Find(Key);
+            Next = Lexer();
+            if (Next.Type != sJSONTokenType::Colon) {
+                return Fail(Next);
+            }
+
+            Next = Lexer();
+            bool Read;
+            if (Index == Table::Count || (Seen >> Index & 1) != 0) {
+                Read = SkipValue(Next);
+            } else {
+                Seen |= 1ULL << Index;
+                Read = Table::Visit(Index, [&](const auto &Field) { return ReadValue(Target.*(Field.Pointer), Next); });
+            }
+            if (!Read) {
+                return false;
+            }
+
+            Next = Lexer();
+            if (Next.Type == sJSONTokenType::BigRight) {
+                return true;
+            }
+            if (Next.Type != sJSONTokenType::Comma) {
+                return Fail(Next);
+            }
+            Next = Lexer();
+        }
+    }
+
+    // Integers have to fit the member; fractions and exponents only go into floating point members.
+    template<class Type>
+    bool ReadNumber(Type &Target, const sJSONToken &Token) {
+        if (Token.Type != sJSONTokenType::Number && Token.Type != sJSONTokenType::Float) {
+            return Fail(Token);
+        }
+
+        sJSONNumber Number;
+        bool Fits = sJSONParseNumber(Lexer.GetText(Token), Number);
+        if constexpr (std::is_floating_point_v<Type>) {
+            if (Number.Type == sJSONNumberType::Double) {
+                Target = static_cast<Type>(Number.Float);
+            } else if (Number.Type == sJSONNumberType::UInt64) {
+                Target = static_cast<Type>(Number.Unsigned);
+            } else {
+                Target = static_cast<Type>(Number.Integer);
+            }
+        } else {
+            using Limits = std::numeric_limits<Type>;
+            if (Number.Type == sJSONNumberType::Double) {
+                Fits = false;
+            } else if (Number.Type == sJSONNumberType::UInt64) {
+                Fits = Fits && Number.Unsigned <= static_cast<uint64_t>(Limits::max());
+                Target = static_cast<Type>(Number.Unsigned);
+            } else if constexpr (std::is_signed_v<Type>) {
+                Fits = Fits && Number.Integer >= static_cast<int64_t>(Limits::min()) &&
+                       Number.Integer <= static_cast<int64_t>(Limits::max());
+                Target = static_cast<Type>(Number.Integer);
+            } else {
+                Fits = Fits && Number.Integer >= 0 && static_cast<uint64_t>(Number.Integer) <= Limits::max();
+                Target = static_cast<Type>(Number.Integer);
+            }
+        }
+
+        if (!Fits) {
+            Status.ErrorInfo.push_back("<Bad number>");
+        }
+        return Fits;
+    }
+
+    // Steps over the value of an unknown member with the checks ReadValue makes: separators in their
+    // places, matching brackets, valid numbers and escapes. Nothing is stored.
+    bool SkipValue(sJSONToken Token) {
+        std::string Closers;
+        bool InKey = false;
+        do {
+            if (InKey && Token.Type != sJSONTokenType::string) {
+                return Fail(Token);
+            }
+
+            switch (Token.Type) {
+                case sJSONTokenType::BigLeft:
+                case sJSONTokenType::MiddleLeft: {
+                    Closers.push_back(Token.Type == sJSONTokenType::BigLeft ? '}' : ']');
+                    Token = Lexer();
+                    if (Token.Type == sJSONCloserType(Closers.back())) {
+                        Closers.pop_back();
+                        break;
+                    }
+                    InKey = Closers.back() == '}';
+                    continue;
+                }
+                case sJSONTokenType::string: {
+                    std::string_view Text;
+                    if (!DecodeKey(Token, Text)) {
+                        return false;
+                    }
+                    if (!InKey) {
+                        break;
+                    }
+
+                    InKey = false;
+                    Token = Lexer();
+                    if (Token.Type != sJSONTokenType::Colon) {
+                        return Fail(Token);
+                    }
+                    Token = Lexer();
+                    continue;
+                }
+                case sJSONTokenType::Number:
+                case sJSONTokenType::Float: {
+                    sJSONNumber Number;
+                    if (!sJSONParseNumber(Lexer.GetText(Token), Number)) {
+                        Status.ErrorInfo.push_back("<Bad number>");
+                        return false;
+                    }
+                    break;
+                }
+                case sJSONTokenType::Boolean:
+                case sJSONTokenType::Null: {
+                    break;
+                }
+                default: {
+                    return Fail(Token);
+                }
+            }
+
+            // A value is complete; its container goes on after a comma or ends.
+            while (!Closers.empty()) {
+                Token = Lexer();
+                if (Token.Type == sJSONTokenType::Comma) {
+                    InKey = Closers.back() == '}';
+                    break;
+                }
+                if (Token.Type != sJSONCloserType(Closers.back())) {
+                    return Fail(Token);
+                }
+                Closers.pop_back();
+            }
+            if (Closers.empty()) {
+                return true;
+            }
+
+            Token = Lexer();
+        } while (true);
+    }
+
+    bool DecodeKey(const sJSONToken &Token, std::string_view &Key) {
+        Key = Lexer.GetText(Token);
+        if (!Token.Escaped) {
+            return true;
+        }
+
+        Buffer.resize(Key.size());
+        size_t Size = sJSONDecodeString(Key, Buffer.data());
+        if (Size == sJSONBadString) {
+            Status.ErrorInfo.push_back("<Bad string>");
+            return false;
+        }
+
+        Key = std::string_view(Buffer.data(), Size);
+        return true;
+    }
+
+    bool Fail(const sJSONToken &Token) {
+        if (Token.Type == sJSONTokenType::End) {
+            Status.ErrorInfo.push_back("<Bad sJSON tree>");
+        } else {
+            Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
+        }
+
+        return false;
+    }
+
+private:
+    sJSONParserStatus Status;
+    sJSONLexer Lexer;
+    std::string Buffer;
+};
+
+// Passes everything on to another sink and counts the bytes.
+template<class Sink>
+class sJSONCountingSink {
+public:
+    sJSONCountingSink(Sink &Target) : Target(&Target), Bytes(0) {
+    }
+
+public:
+    __forceinline void Write(const char *Data, size_t Size) {
+        Bytes += Size;
+        Target->Write(Data, Size);
+    }
+
+    __forceinline void Put(char Character) {
+        ++Bytes;
+        Target->Put(Character);
+    }
+
+    const size_t GetBytes() const {
+        return Bytes;
+    }
+
+private:
+    Sink *Target;
+    size_t Bytes;
+};
+
+enum class sJSONPatchOperation {
+    Add,
+    Remove,
+    Replace
+};
+
+// One operation of a JSON Patch (RFC 6902). Path is a JSON Pointer (RFC 6901) and Value points into the
+// target tree of the diff; it is nullptr for Remove.
+struct sJSONPatch {
+    sJSONPatchOperation Operation;
+    std::string Path;
+    sJSONValue *Value;
+};
+
+struct sJSONHashFrame {
+    sJSONValue *Container;
+    size_t Index;
+    uint64_t Sum;
+};
+
+struct sJSONDiffFrame {
+    sJSONValue *Source;
+    sJSONValue *Target;
+    std::string Path;
+};
+
+// Structural hashing, equality and diff of trees. Hashes do not depend on the order of object members
+// and take numbers by value, so 1 held as int, int64_t or double hashes and compares the same. The hash
+// of a container is kept in its edit state and computed again only once the container or something
+// below it changed, which needs the same care as sJSONWriter::WriteCached: edits go through the
+// mutation methods of sJSONObject and sJSONArray, or are followed by Invalidate().
+class sJSONComparer {
+public:
+    static uint64_t Hash(sJSONValue *Value) {
+        auto State = Value->GetEditState();
+        if (State == nullptr) {
+            return HashScalar(Value);
+        }
+        if (State->HashRevision == State->Revision) {
+            return State->Hash;
+        }
+
+        std::vector<sJSONHashFrame> Stack(1, {Value, 0, 0});
+        while (true) {
+            auto Container = Stack.back().Container;
+            bool Object = Container->GetType() == sJSONValueType::Object;
+            size_t Size = Object ? static_cast<sJSONObject *>(Container)->Children.Size()
+                                 : static_cast<sJSONArray *>(Container)->ValueSet.size();
+            if (Stack.back().Index == Size) {
+                State = Container->GetEditState();
+                State->Hash = Mix(Stack.back().Sum ^ (Object ? 0x6A09E667F3BCC908ULL : 0xBB67AE8584CAA73BULL) ^
+                                  Size * 0x9E3779B97F4A7C15ULL);
+                State->HashRevision = State->Revision;
+                Stack.pop_back();
+                if (Stack.empty()) {
+                    return State->Hash;
+                }
+
+                Accumulate(Stack.back(), State->Hash);
+                continue;
+            }
+
+            sJSONValue *Child;
+            if (Object) {
+                auto Member = static_cast<sJSONObject *>(Container)->Children.At(Stack.back().Index).second;
+                Member->Edit.Parent = Container->GetEditState();
+                Child = Member->Value;
+            } else {
+                Child = static_cast<sJSONArray *>(Container)->ValueSet[Stack.back().Index];
+            }
+            auto ChildState = Child->GetEditState();
+            if (ChildState == nullptr) {
+                Accumulate(Stack.back(), HashScalar(Child));
+                continue;
+            }
+
+            // Linked even when cached: the child may have been hashed on its own, before its parent.
+            ChildState->Parent = Container->GetEditState();
+            if (ChildState->HashRevision == ChildState->Revision) {
+                Accumulate(Stack.back(), ChildState->Hash);
+            } else {
+                Stack.push_back({Child, 0, 0});
+            }
+        }
+    }
+
+    // Different hashes settle it at once; equal ones are confirmed member by member, skipping the
+    // containers whose cached hashes already differ.
+    static bool Equal(sJSONValue *Left, sJSONValue *Right) {
+        if (Hash(Left) != Hash(Right)) {
+            return false;
+        }
+
+        std::vector<std::pair<sJSONValue *, sJSONValue *>> Pending(1, {Left, Right});
+        while (!Pending.empty()) {
+            auto [Source, Target] = Pending.back();
+            Pending.pop_back();
+            if (Source == Target) {
+                continue;
+            }
+            if (Source->GetType() != Target->GetType()) {
+                return false;
+            }
+
+            switch (Source->GetType()) {
+                case sJSONValueType::Object: {
+                    auto &SourceChildren = static_cast<sJSONObject *>(Source)->Children;
+                    auto &TargetChildren = static_cast<sJSONObject *>(Target)->Children;
+                    if (SourceChildren.Size() != TargetChildren.Size() || Hash(Source) != Hash(Target)) {
+                        return false;
+                    }
+                    for (auto &Member : SourceChildren) {
+                        auto Match = TargetChildren.Find(Member.first);
+                        if (Match == nullptr) {
+                            return false;
+                        }
+                        Pending.emplace_back(Member.second->Value, Match->Value);
+                    }
+                    break;
+                }
+                case sJSONValueType::Array: {
+                    auto &SourceSet = static_cast<sJSONArray *>(Source)->ValueSet;
+                    auto &TargetSet = static_cast<sJSONArray *>(Target)->ValueSet;
+                    if (SourceSet.size() != TargetSet.size() || Hash(Source) != Hash(Target)) {
+                        return false;
+                    }
+                    for (size_t Index = 0; Index < SourceSet.size(); ++Index) {
+                        Pending.emplace_back(SourceSet[Index], TargetSet[Index]);
+                    }
+                    break;
+                }
+                default: {
+                    if (!EqualScalar(Source, Target)) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static bool Equal(sJSONRootNode &Left, sJSONRootNode &Right) {
+        return Equal(Left.GetObject(), Right.GetObject());
+    }
+
+    // The operations that turn Source into Target, descending only into the subtrees whose hashes
+    // differ. Arrays keep their common head and tail and pair up the elements in between, so a single
+    // insertion or removal becomes a single operation. The operations apply in the order given.
+    static std::vector<sJSONPatch> Diff(sJSONValue *Source, sJSONValue *Target) {
+        std::vector<sJSONPatch> Patch;
+        std::vector<sJSONDiffFrame> Pending;
+        Pending.push_back({Source, Target, std::string()});
+        while (!Pending.empty()) {
+            auto Frame = std::move(Pending.back());
+            Pending.pop_back();
+            if (Same(Frame.Source, Frame.Target)) {
+                continue;
+            }
+
+            auto Type = Frame.Source->GetType();
+            if (Type != Frame.Target->GetType() || (Type != sJSONValueType::Object && Type != sJSONValueType::Array)) {
+                Patch.push_back({sJSONPatchOperation::Replace, std::move(Frame.Path), Frame.Target});
+                continue;
+            }
+
+            size_t First = Pending.size();
+            if (Type == sJSONValueType::Object) {
+                auto &SourceChildren = static_cast<sJSONObject *>(Frame.Source)->Children;
+                auto &TargetChildren = static_cast<sJSONObject *>(Frame.Target)->Children;
+                for (auto &Member : SourceChildren) {
+                    if (TargetChildren.Find(Member.first) == nullptr) {
+                        Patch.push_back({sJSONPatchOperation::Remove, Pointer(Frame.Path, Member.first), nullptr});
+                    }
+                }
+                for (auto &Member : TargetChildren) {
+                    if (auto Match = SourceChildren.Find(Member.first)) {
+                        Pending.push_back({Match->Value, Member.second->Value, Pointer(Frame.Path, Member.first)});
+                    } else {
+                        Patch.push_back({sJSONPatchOperation::Add, Pointer(Frame.Path, Member.first),
+                                         Member.second->Value});
+                    }
+                }
+            } else {
+                auto &SourceSet = static_cast<sJSONArray *>(Frame.Source)->ValueSet;
+                auto &TargetSet = static_cast<sJSONArray *>(Frame.Target)->ValueSet;
+                size_t Head = 0;
+                size_t Tail = 0;
+                size_t Shorter = std::min(SourceSet.size(), TargetSet.size());
+                while (Head < Shorter && Same(SourceSet[Head], TargetSet[Head])) {
+                    ++Head;
+                }
+                while (Tail < Shorter - Head &&
+                       Same(SourceSet[SourceSet.size() - Tail - 1], TargetSet[TargetSet.size() - Tail - 1])) {
+                    ++Tail;
+                }
+
+                // Everything past the paired elements shifts, the paired ones keep their indices.
+                size_t Paired = Shorter - Head - Tail;
+                for (size_t Index = Head; Index < Head + Paired; ++Index) {
+                    Pending.push_back({SourceSet[Index], TargetSet[Index], Pointer(Frame.Path, Index)});
+                }
+                for (size_t Index = Head + Paired; Index < SourceSet.size() - Tail; ++Index) {
+                    Patch.push_back({sJSONPatchOperation::Remove, Pointer(Frame.Path, Head + Paired), nullptr});
+                }
+                for (size_t Index = Head + Paired; Index < TargetSet.size() - Tail; ++Index) {
+                    Patch.push_back({sJSONPatchOperation::Add, Pointer(Frame.Path, Index), TargetSet[Index]});
+                }
+            }
+            std::reverse(Pending.begin() + First, Pending.end());
+        }
+
+        return Patch;
+    }
+
+    static std::vector<sJSONPatch> Diff(sJSONRootNode &Source, sJSONRootNode &Target) {
+        return Diff(Source.GetObject(), Target.GetObject());
+    }
+
+private:
+    static __forceinline uint64_t Mix(uint64_t Value) {
+        Value ^= Value >> 30;
+        Value *= 0xBF58476D1CE4E5B9ULL;
+        Value ^= Value >> 27;
+        Value *= 0x94D049BB133111EBULL;
+        return Value ^ (Value >> 31);
+    }
+
+    // Members add up, so their order does not matter; elements chain, so it does.
+    static void Accumulate(sJSONHashFrame &Frame, uint64_t Hash) {
+        if (Frame.Container->GetType() == sJSONValueType::Object) {
+            auto &Member = static_cast<sJSONObject *>(Frame.Container)->Children.At(Frame.Index);
+            Frame.Sum += Mix(sJSONHashKey(Member.first) ^ Mix(Hash));
+        } else {
+            Frame.Sum = Mix(Frame.Sum ^ Hash);
+        }
+        ++Frame.Index;
+    }
+
+    static bool Same(sJSONValue *Source, sJSONValue *Target) {
+        return Source == Target || (Hash(Source) == Hash(Target) && Equal(Source, Target));
+    }
+
+    static std::string Pointer(const std::string &Path, std::string_view Key) {
+        std::string Result;
+        Result.reserve(Path.size() + Key.size() + 1);
+        Result += Path;
+        Result += '/';
+        for (auto Character : Key) {
+            if (Character == '~') {
+                Result += "~0";
+            } else if (Character == '/') {
+                Result += "~1";
+            } else {
+                Result += Character;
+            }
+        }
+
+        return Result;
+    }
+
+    static std::string Pointer(const std::string &Path, size_t Index) {
+        return Path + '/' + std::to_string(Index);
+    }
+
+    enum class ScalarType {
+        Null,
+        String,
+        OwnedString,
+        Boolean,
+        Int,
+        Int64,
+        UInt64,
+        Double,
+        Other
+    };
+
+    // One GetHash() call per scalar rather than one per type tried.
+    static ScalarType GetScalarType(sJSONValue *Value) {
+        static const size_t Codes[] = {typeid(std::string_view).hash_code(), typeid(std::string).hash_code(),
+                                       typeid(bool).hash_code(),             typeid(int).hash_code(),
+                                       typeid(int64_t).hash_code(),          typeid(uint64_t).hash_code(),
+                                       typeid(double).hash_code()};
+        if (Value->GetType() == sJSONValueType::Null) {
+            return ScalarType::Null;
+        }
+        if (Value->GetType() != sJSONValueType::Value) {
+            return ScalarType::Other;
+        }
+
+        size_t Code = Value->GetHash();
+        for (size_t Index = 0; Index < sizeof(Codes) / sizeof(Codes[0]); ++Index) {
+            if (Codes[Index] == Code) {
+                return static_cast<ScalarType>(Index + 1);
+            }
+        }
+
+        return ScalarType::Other;
+    }
+
+    static bool IsNumber(ScalarType Type) {
+        return Type >= ScalarType::Int && Type <= ScalarType::Double;
+    }
+
+    static std::string_view GetText(sJSONValue *Value, ScalarType Type) {
+        if (Type == ScalarType::String) {
+            return static_cast<sJSONstring *>(Value)->Value;
+        }
+
+        return static_cast<sJSONRealValue<std::string> *>(Value)->Value;
+    }
+
+    // Brings every number to one form: Int64 for the integers that fit it, whatever type holds them,
+    // UInt64 for larger ones and Double for the rest.
+    static sJSONNumber GetNumber(sJSONValue *Value, ScalarType Type) {
+        sJSONNumber Number;
+        Number.Type = sJSONNumberType::Int64;
+        switch (Type) {
+            case ScalarType::Int: {
+                Number.Integer = static_cast<sJSONInt *>(Value)->Value;
+                break;
+            }
+            case ScalarType::Int64: {
+                Number.Integer = static_cast<sJSONInt64 *>(Value)->Value;
+                break;
+            }
+            case ScalarType::UInt64: {
+                Number.Unsigned = static_cast<sJSONUInt64 *>(Value)->Value;
+                if (Number.Unsigned > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                    Number.Type = sJSONNumberType::UInt64;
+                }
+                break;
+            }
+            default: {
+                double Float = static_cast<sJSONDouble *>(Value)->Value;
+                if (Float >= -9223372036854775808.0 && Float < 9223372036854775808.0 &&
+                    static_cast<double>(static_cast<int64_t>(Float)) == Float) {
+                    Number.Integer = static_cast<int64_t>(Float);
+                } else if (Float >= 0 && Float < 18446744073709551616.0 &&
+                           static_cast<double>(static_cast<uint64_t>(Float)) == Float) {
+                    Number.Type = sJSONNumberType::UInt64;
+                    Number.Unsigned = static_cast<uint64_t>(Float);
+                } else {
+                    Number.Type = sJSONNumberType::Double;
+                    Number.Float = Float;
+                }
+                break;
+            }
+        }
+
+        return Number;
+    }
+
+    static uint64_t HashScalar(sJSONValue *Value) {
+        auto Type = GetScalarType(Value);
+        switch (Type) {
+            case ScalarType::Null: {
+                return Mix(0x3C6EF372FE94F82BULL);
+            }
+            case ScalarType::String:
+            case ScalarType::OwnedString: {
+                return Mix(sJSONHashKey(GetText(Value, Type)) ^ 0xA54FF53A5F1D36F1ULL);
+            }
+            case ScalarType::Boolean: {
+                return Mix(0x510E527FADE682D1ULL + static_cast<sJSONBoolean *>(Value)->Value);
+            }
+            case ScalarType::Other: {
+                return Mix(reinterpret_cast<uintptr_t>(Value));
+            }
+            default: {
+                auto Number = GetNumber(Value, Type);
+                uint64_t Bits;
+                memcpy(&Bits, &Number.Float, sizeof(Bits));
+                return Mix(Bits ^ (Number.Type == sJSONNumberType::Double ? 0x9B05688C2B3E6C1FULL
+                                                                           : 0x1F83D9ABFB41BD6BULL));
+            }
+        }
+    }
+
+    static bool EqualScalar(sJSONValue *Source, sJSONValue *Target) {
+        auto SourceType = GetScalarType(Source);
+        auto TargetType = GetScalarType(Target);
+        switch (SourceType) {
+            case ScalarType::Null: {
+                return TargetType == ScalarType::Null;
+            }
+            case ScalarType::String:
+            case ScalarType::OwnedString: {
+                return (TargetType == ScalarType::String || TargetType == ScalarType::OwnedString) &&
+                       GetText(Source, SourceType) == GetText(Target, TargetType);
+            }
+            case ScalarType::Boolean: {
+                return TargetType == ScalarType::Boolean &&
+                       static_cast<sJSONBoolean *>(Source)->Value == static_cast<sJSONBoolean *>(Target)->Value;
+            }
+            case ScalarType::Other: {
+                return false;
+            }
+            default: {
+                if (!IsNumber(TargetType)) {
+                    return false;
+                }
+
+                auto SourceNumber = GetNumber(Source, SourceType);
+                auto TargetNumber = GetNumber(Target, TargetType);
+                if (SourceNumber.Type != TargetNumber.Type) {
+                    return false;
+                }
+
+                return SourceNumber.Type == sJSONNumberType::Double ? SourceNumber.Float == TargetNumber.Float
+                                                                    : SourceNumber.Unsigned == TargetNumber.Unsigned;
+            }
+        }
+    }
+};
+
+struct sJSONWriterFrame {
+    sJSONValue *Container;
+    size_t Index;
+};
+
+// What sJSONWriter::WriteCached keeps between writes of a tree: the text of the last write, and where
+// each container written into it sits, relative to its parent, with the revisions both had then. A
+// container whose revision did not change is copied from there instead of being written again. Text
+// shorter than MinBytes is always written again, as that is cheaper than keeping track of it. Switching
+// to another tree or format starts over with a full write.
+class sJSONWriteCache {
 public:
-    ErrorList ErrorInfo;
-    Iterator NativeIterator;
+    explicit sJSONWriteCache(size_t MinBytes = 32) : Root(nullptr), Format(false), MinBytes(MinBytes) {
+    }
+
+public:
+    void Clear() {
+        Spans.clear();
+        Text.clear();
+        Root = nullptr;
+    }
+
+    // Number of containers whose text can be reused.
+    const size_t Size() const {
+        return Spans.size();
+    }
+
+    const size_t GetBytes() const {
+        return Text.size() + Spans.size() * sizeof(Span);
+    }
+
+private:
+    friend class sJSONWriter;
+
+    struct Span {
+        const sJSONValue *Parent;
+        uint64_t Revision;
+        uint64_t ParentRevision;
+        size_t Offset;
+        size_t Length;
+    };
+
+private:
+    std::unordered_map<const sJSONValue *, Span> Spans;
+    std::string Text;
+    sJSONStringSink Scratch;
+    const sJSONValue *Root;
+    bool Format;
+    size_t MinBytes;
+};
+
+struct sJSONCachedFrame {
+    sJSONValue *Container;
+    size_t Index;
+    size_t Start;
+    // Where the container starts in the text of the last write and its revision then, or npos when
+    // that text is not known and everything in it has to be written.
+    size_t OldStart;
+    uint64_t OldRevision;
+};
+
+class sJSONWriter {
+public:
+    static std::string WriteJSON(sJSONRootNode &Root, bool Format = true, bool Brackets = true, size_t Level = 1) {
+        sJSONStringSink Output;
+        WriteJSON(Root, Output, Format, Brackets, Level - 1);
+
+        return Output.Release();
+    }
+
+    static std::string
+    WriteJSON(sJSONElementFinder &Finder, bool Format = true, bool Brackets = true, size_t Level = 1) {
+        sJSONStringSink Output;
+        WriteJSON(Finder, Output, Format, Brackets, Level - 1);
+
+        return Output.Release();
+    }
+
+    static std::string WriteJSONByObject(sJSONObject *Object, bool Format = true, bool Brackets = true,
+                                         size_t Level = 1) {
+        sJSONStringSink Output;
+        WriteValue(Object, Output, Format, Brackets, Level - 1);
+
+        return Output.Release();
+    }
+
+    static std::string
+    WriteJSONByArray(sJSONArray *Object, bool Format = true, bool Brackets = true, size_t Level = 1) {
+        sJSONStringSink Output;
+        WriteValue(Object, Output, Format, Brackets, Level - 1);
+
+        return Output.Release();
+    }
+
+    static std::string WriteValue(sJSONValue *Node, bool Format = true, bool Brackets = true, size_t Level = 1) {
+        sJSONStringSink Output;
+        WriteValue(Node, Output, Format, Brackets, Level);
+
+        return Output.Release();
+    }
+
+    static std::string WriteTape(const sJSONTapeValue &Value, bool Format = true) {
+        sJSONStringSink Output;
+        WriteTape(Value, Output, Format);
+
+        return Output.Release();
+    }
+
+    static std::string WriteJSON(sJSONRootNode &Root, sJSONStatsObserver *Observer, bool Format = true) {
+        sJSONStringSink Output;
+        WriteJSON(Root, Output, Observer, Format);
+
+        return Output.Release();
+    }
+
+    static std::string WriteCached(sJSONRootNode &Root, sJSONWriteCache &Cache, bool Format = true) {
+        BuildCached(Root, Cache, Format);
+
+        return Cache.Text;
+    }
+
+    static std::string WritePatch(const std::vector<sJSONPatch> &Patch, bool Format = true) {
+        sJSONStringSink Output;
+        WritePatch(Patch, Output, Format);
+
+        return Output.Release();
+    }
+
+public:
+    // Streams the tree into Output, which needs Write(const char *, size_t) and Put(char). Depth is the
+    // indentation level of the outermost brackets.
+    template<class Sink>
+    static void WriteJSON(sJSONRootNode &Root, Sink &Output, bool Format = true, bool Brackets = true,
+                          size_t Depth = 0) {
+        WriteValue(Root.GetObject(), Output, Format, Brackets, Depth);
+    }
+
+    // Same as above, reporting the size and duration of the write to Observer.
+    template<class Sink>
+    static void WriteJSON(sJSONRootNode &Root, Sink &Output, sJSONStatsObserver *Observer, bool Format = true) {
+        auto Start = std::chrono::steady_clock::now();
+        sJSONCountingSink<Sink> Counted(Output);
+        WriteValue(Root.GetObject(), Counted, Format, true, 0);
+
+        double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        Observer->OnWrite({Counted.GetBytes(), Seconds, Format});
+    }
+
+    // Writes the same text as WriteJSON, copying the text Cache holds for every container that kept its
+    // revision since it was written and formatting only the containers changed in between. Edits must go
+    // through the mutation methods of sJSONObject and sJSONArray, or be followed by Invalidate().
+    template<class Sink>
+    static void WriteCached(sJSONRootNode &Root, sJSONWriteCache &Cache, Sink &Output, bool Format = true) {
+        BuildCached(Root, Cache, Format);
+        Output.Write(Cache.Text.data(), Cache.Text.size());
+    }
+
+    // Writes the operations of sJSONComparer::Diff as the JSON array RFC 6902 describes.
+    template<class Sink>
+    static void WritePatch(const std::vector<sJSONPatch> &Patch, Sink &Output, bool Format = true) {
+        static constexpr std::string_view Names[] = {"add", "remove", "replace"};
+        Output.Put('[');
+        for (size_t Index = 0; Index < Patch.size(); ++Index) {
+            auto &Operation = Patch[Index];
+            auto Name = Names[static_cast<size_t>(Operation.Operation)];
+            Separate(Output, Format, Index != 0, 1);
+            Output.Put('{');
+            Separate(Output, Format, false, 2);
+            Output.Write("\"op\":\"", 6);
+            Output.Write(Name.data(), Name.size());
+            Output.Put('\"');
+            Separate(Output, Format, true, 2);
+            Output.Write("\"path\":\"", 8);
+            sJSONWriteEscaped(Output, Operation.Path);
+            Output.Put('\"');
+            if (Operation.Value != nullptr) {
+                Separate(Output, Format, true, 2);
+                Output.Write("\"value\":", 8);
+                WriteValue(Operation.Value, Output, Format, true, 2);
+            }
+            CloseStruct(Output, Format, false, 1, '}');
+        }
+        CloseStruct(Output, Format, Patch.empty(), 0, ']');
+    }
+
+    template<class Sink>
+    static void WriteJSON(sJSONElementFinder &Finder, Sink &Output, bool Format = true, bool Brackets = true,
+                          size_t Depth = 0) {
+        auto Node = Finder.GetNode();
+        if (Node->Value != nullptr) {
+            WriteValue(Node->Value, Output, Format, Brackets, Depth);
+        } else {
+            WriteValue(Node, Output, Format, Brackets, Depth);
+        }
+    }
+
+    template<class Sink>
+    static void WriteValue(sJSONValue *Node, Sink &Output, bool Format = true, bool Brackets = true,
+                           size_t Depth = 0) {
+        std::vector<sJSONWriterFrame> Stack;
+        Open(Node, Output, Stack, Brackets);
+
+        while (!Stack.empty()) {
+            auto &Frame = Stack.back();
+            size_t Level = Depth + Stack.size();
+            sJSONValue *Value;
+            if (Frame.Container->GetType() == sJSONValueType::Object) {
+                auto &Children = static_cast<sJSONObject *>(Frame.Container)->Children;
+                if (Frame.Index == Children.Size()) {
+                    Close(Output, Stack, Format, Brackets, Level, '}');
+                    continue;
+                }
+
+                auto &Member = Children.At(Frame.Index++);
+                Separate(Output, Format, Frame.Index != 1, Level);
+                Output.Put('\"');
+                sJSONWriteEscaped(Output, Member.first);
+                Output.Write("\":", 2);
+                Value = Member.second->Value;
+            } else {
+                auto &ValueSet = static_cast<sJSONArray *>(Frame.Container)->ValueSet;
+                if (Frame.Index == ValueSet.size()) {
+                    Close(Output, Stack, Format, Brackets, Level, ']');
+                    continue;
+                }
+
+                Separate(Output, Format, Frame.Index != 0, Level);
+                Value = ValueSet[Frame.Index++];
+            }
+
+            Open(Value, Output, Stack, Brackets);
+        }
+    }
+
+    // Writes a value of a tape document with the same layout WriteJSON gives the equivalent tree, in one
+    // pass along the tape.
+    template<class Sink>
+    static void WriteTape(const sJSONTapeValue &Value, Sink &Output, bool Format = true, size_t Depth = 0) {
+        if (!Value.IsValid()) {
+            return;
+        }
+
+        auto &Tape = Value.GetDocument()->GetTape();
+        size_t End = Value.GetDocument()->Skip(Value.GetIndex());
+        std::vector<std::pair<bool, size_t>> Stack;
+        char Buffer[32];
+        for (size_t Position = Value.GetIndex(); Position < End;) {
+            auto Tag = static_cast<sJSONTapeTag>(Tape[Position] >> 56);
+            if (Tag == sJSONTapeTag::EndObject || Tag == sJSONTapeTag::EndArray) {
+                bool Empty = Stack.back().second == 0;
+                Stack.pop_back();
+                CloseStruct(Output, Format, Empty, Depth + Stack.size(), Tag == sJSONTapeTag::EndObject ? '}' : ']');
+                ++Position;
+                continue;
+            }
+
+            if (!Stack.empty()) {
+                auto &Top = Stack.back();
+                Separate(Output, Format, Top.second++ != 0, Depth + Stack.size());
+                if (Top.first) {
+                    auto Key = sJSONTapeValue(Value.GetDocument(), Position++).To<std::string_view>();
+                    Output.Put('\"');
+                    sJSONWriteEscaped(Output, Key);
+                    Output.Write("\":", 2);
+                    Tag = static_cast<sJSONTapeTag>(Tape[Position] >> 56);
+                }
+            }
+
+            switch (Tag) {
+                case sJSONTapeTag::StartObject:
+                case sJSONTapeTag::StartArray: {
+                    Output.Put(static_cast<char>(Tag));
+                    Stack.emplace_back(Tag == sJSONTapeTag::StartObject, 0);
+                    ++Position;
+                    continue;
+                }
+                case sJSONTapeTag::String: {
+                    auto Text = sJSONTapeValue(Value.GetDocument(), Position).To<std::string_view>();
+                    Output.Put('\"');
+                    sJSONWriteEscaped(Output, Text);
+                    Output.Put('\"');
+                    break;
+                }
+                case sJSONTapeTag::Int64: {
+                    auto Number = static_cast<int64_t>(Tape[Position + 1]);
+                    Output.Write(Buffer, sJSONFormatNumber(Buffer, Number) - Buffer);
+                    break;
+                }
+                case sJSONTapeTag::UInt64: {
+                    Output.Write(Buffer, sJSONFormatNumber(Buffer, Tape[Position + 1]) - Buffer);
+                    break;
+                }
+                case sJSONTapeTag::Double: {
+                    auto Number = sJSONTapeValue(Value.GetDocument(), Position).To<double>();
+                    Output.Write(Buffer, sJSONFormatNumber(Buffer, Number) - Buffer);
+                    break;
+                }
+                case sJSONTapeTag::True: {
+                    Output.Write("true", 4);
+                    break;
+                }
+                case sJSONTapeTag::False: {
+                    Output.Write("false", 5);
+                    break;
+                }
+                default: {
+                    Output.Write("null", 4);
+                    break;
+                }
+            }
+            Position = Value.GetDocument()->Skip(Position);
+        }
+    }
+
+    // Writes a mapped struct, or a std::vector, std::optional, string, bool or number, straight to Output
+    // with the same layout WriteJSON gives the equivalent tree.
+    template<class Type, class Sink>
+    static void WriteStruct(const Type &Value, Sink &Output, bool Format = true, size_t Depth = 0) {
+        if constexpr (sJSONIsMapped<Type>::value) {
+            size_t Count = 0;
+            Output.Put('{');
+            std::apply(
+                    [&](const auto &...Fields) {
+                        ((Separate(Output, Format, Count++ != 0, Depth + 1), Output.Put('\"'),
+                          sJSONWriteEscaped(Output, Fields.Name), Output.Write("\":", 2),
+                          WriteStruct(Value.*(Fields.Pointer), Output, Format, Depth + 1)),
+                         ...);
+                    },
+                    sJSONMapping<Type>::Fields);
+            CloseStruct(Output, Format, Count == 0, Depth, '}');
+        } else if constexpr (sJSONIsVector<Type>::value) {
+            Output.Put('[');
+            for (size_t Index = 0; Index < Value.size(); ++Index) {
+                Separate(Output, Format, Index != 0, Depth + 1);
+                WriteStruct(Value[Index], Output, Format, Depth + 1);
+            }
+            CloseStruct(Output, Format, Value.empty(), Depth, ']');
+        } else if constexpr (sJSONIsOptional<Type>::value) {
+            if (Value.has_value()) {
+                WriteStruct(*Value, Output, Format, Depth);
+            } else {
+                Output.Write("null", 4);
+            }
+        } else if constexpr (std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view>) {
+            Output.Put('\"');
+            sJSONWriteEscaped(Output, Value);
+            Output.Put('\"');
+        } else if constexpr (std::is_same_v<Type, bool>) {
+            if (Value) {
+                Output.Write("true", 4);
+            } else {
+                Output.Write("false", 5);
+            }
+        } else {
+            static_assert(std::is_arithmetic_v<Type>, "sJSONWriter::WriteStruct cannot write this member type");
+
+            char Buffer[32];
+            if constexpr (std::is_same_v<Type, float>) {
+                Output.Write(Buffer, sJSONFormatNumber(Buffer, Value) - Buffer);
+            } else if constexpr (std::is_floating_point_v<Type>) {
+                Output.Write(Buffer, sJSONFormatNumber(Buffer, static_cast<double>(Value)) - Buffer);
+            } else {
+                Output.Write(Buffer, sJSONFormatNumber(Buffer, Value) - Buffer);
+            }
+        }
+    }
+
+    template<class Type>
+    static std::string WriteStruct(const Type &Value, bool Format = true) {
+        sJSONStringSink Output;
+        WriteStruct(Value, Output, Format);
+
+        return Output.Release();
+    }
+
+    // Writes the binary form of the tree that sJSONParser::ParseBinary loads: a key table with every
+    // distinct key once, then the values as tags with varint counts, lengths and integers.
+    template<class Sink>
+    static void WriteBinary(sJSONRootNode &Root, Sink &Output) {
+        std::unordered_map<std::string_view, uint64_t> KeyIndex;
+        std::vector<std::string_view> Keys;
+        std::vector<sJSONValue *> Pending(1, Root.GetObject());
+        while (!Pending.empty()) {
+            auto Container = Pending.back();
+            Pending.pop_back();
+            if (Container->GetType() == sJSONValueType::Object) {
+                for (auto &Member : static_cast<sJSONObject *>(Container)->Children) {
+                    if (KeyIndex.emplace(Member.first, Keys.size()).second) {
+                        Keys.push_back(Member.first);
+                    }
+                    Pending.push_back(Member.second->Value);
+                }
+            } else if (Container->GetType() == sJSONValueType::Array) {
+                auto &ValueSet = static_cast<sJSONArray *>(Container)->ValueSet;
+                Pending.insert(Pending.end(), ValueSet.begin(), ValueSet.end());
+            }
+        }
+
+        char Buffer[16];
+        Output.Write(sJSONBinaryMagic, sizeof(sJSONBinaryMagic));
+        Output.Write(Buffer, sJSONEncodeVarint(Buffer, Keys.size()) - Buffer);
+        for (auto Key : Keys) {
+            Output.Write(Buffer, sJSONEncodeVarint(Buffer, Key.size()) - Buffer);
+            Output.Write(Key.data(), Key.size());
+        }
+
+        std::vector<sJSONWriterFrame> Stack;
+        WriteBinaryValue(Root.GetObject(), Output, Stack);
+        while (!Stack.empty()) {
+            auto &Frame = Stack.back();
+            sJSONValue *Value;
+            if (Frame.Container->GetType() == sJSONValueType::Object) {
+                auto &Children = static_cast<sJSONObject *>(Frame.Container)->Children;
+                if (Frame.Index == Children.Size()) {
+                    Stack.pop_back();
+                    continue;
+                }
+
+                auto &Member = Children.At(Frame.Index++);
+                Output.Write(Buffer, sJSONEncodeVarint(Buffer, KeyIndex.find(Member.first)->second) - Buffer);
+                Value = Member.second->Value;
+            } else {
+                auto &ValueSet = static_cast<sJSONArray *>(Frame.Container)->ValueSet;
+                if (Frame.Index == ValueSet.size()) {
+                    Stack.pop_back();
+                    continue;
+                }
+
+                Value = ValueSet[Frame.Index++];
+            }
+
+            WriteBinaryValue(Value, Output, Stack);
+        }
+    }
+
+    static std::string WriteBinary(sJSONRootNode &Root) {
+        sJSONStringSink Output;
+        WriteBinary(Root, Output);
+
+        return Output.Release();
+    }
+
+    // Writes the tree as a snapshot for sJSONSnapshotView: the same values laid out with offsets
+    // instead of pointers, ready to be mapped and read in place. Snapshots are limited to 4 GiB;
+    // a larger tree gives an empty string.
+    static std::string WriteSnapshot(sJSONRootNode &Root) {
+        std::string Output(sJSONSnapshotLayout::HeaderSize, '\0');
+        memcpy(Output.data(), sJSONSnapshotMagic, sizeof(sJSONSnapshotMagic));
+
+        // Keys are stored once however many objects use them. Children are laid out depth first,
+        // so a subtree stays together in the snapshot.
+        std::unordered_map<std::string_view, uint32_t> KeyOffsets;
+        std::vector<std::pair<size_t, sJSONValue *>> Pending(1, {sJSONSnapshotLayout::RootSlot, Root.GetObject()});
+        while (!Pending.empty()) {
+            auto [Slot, Value] = Pending.back();
+            Pending.pop_back();
+            WriteSnapshotValue(Value, Slot, Output, KeyOffsets, Pending);
+        }
+
+        if (Output.size() > std::numeric_limits<uint32_t>::max()) {
+            return std::string();
+        }
+        sJSONStore32(Output.data() + 4, static_cast<uint32_t>(Output.size()));
+
+        return Output;
+    }
+
+private:
+    template<class Sink>
+    friend class sJSONTranscoder;
+
+    template<class Sink>
+    static void Indent(Sink &Output, size_t Level) {
+        static constexpr char Tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+        constexpr size_t TabCount = sizeof(Tabs) - 1;
+        while (Level > TabCount) {
+            Output.Write(Tabs, TabCount);
+            Level -= TabCount;
+        }
+
+        Output.Write(Tabs, Level);
+    }
+
+    template<class Sink>
+    static void Separate(Sink &Output, bool Format, bool Comma, size_t Level) {
+        if (Comma) {
+            Output.Put(',');
+        }
+        if (Format) {
+            Output.Put('\n');
+            Indent(Output, Level);
+        }
+    }
+
+    template<class Sink>
+    static void Open(sJSONValue *Node, Sink &Output, std::vector<sJSONWriterFrame> &Stack, bool Brackets) {
+        switch (Node->GetType()) {
+            case sJSONValueType::Object: {
+                if (Brackets) {
+                    Output.Put('{');
+                }
+                Stack.push_back({Node, 0});
+                break;
+            }
+            case sJSONValueType::Array: {
+                if (Brackets) {
+                    Output.Put('[');
+                }
+                Stack.push_back({Node, 0});
+                break;
+            }
+            default: {
+                WriteScalar(Node, Output);
+                break;
+            }
+        }
+    }
+
+    template<class Sink>
+    static void CloseStruct(Sink &Output, bool Format, bool Empty, size_t Depth, char Closer) {
+        if (Format && !Empty) {
+            Output.Put('\n');
+            Indent(Output, Depth);
+        }
+        Output.Put(Closer);
+    }
+
+    template<class Sink>
+    static void Close(Sink &Output, std::vector<sJSONWriterFrame> &Stack, bool Format, bool Brackets,
+                      size_t Level, char Closer) {
+        auto &Frame = Stack.back();
+        bool Empty = Frame.Container->GetType() == sJSONValueType::Object
+                             ? static_cast<sJSONObject *>(Frame.Container)->Children.Empty()
+                             : static_cast<sJSONArray *>(Frame.Container)->ValueSet.empty();
+        Stack.pop_back();
+
+        if (Format && !Empty) {
+            Output.Put('\n');
+            Indent(Output, Level - 1);
+        }
+        if (Brackets) {
+            Output.Put(Closer);
+        }
+    }
+
+    // Builds the text in the scratch buffer of Cache, then keeps it as the text of the last write.
+    static void BuildCached(sJSONRootNode &Root, sJSONWriteCache &Cache, bool Format) {
+        if (Cache.Root != Root.GetObject() || Cache.Format != Format) {
+            Cache.Clear();
+            Cache.Root = Root.GetObject();
+            Cache.Format = Format;
+        }
+
+        auto &Buffer = Cache.Scratch;
+        Buffer.GetString().clear();
+        std::vector<sJSONCachedFrame> Stack;
+        OpenCached(Root.GetObject(), Cache, Stack);
+
+        while (!Stack.empty()) {
+            auto &Frame = Stack.back();
+            size_t Level = Stack.size();
+            sJSONValue *Value;
+            if (Frame.Container->GetType() == sJSONValueType::Object) {
+                auto &Children = static_cast<sJSONObject *>(Frame.Container)->Children;
+                if (Frame.Index == Children.Size()) {
+                    CloseCached(Cache, Stack, Format, Children.Empty(), '}');
+                    continue;
+                }
+
+                auto &Member = Children.At(Frame.Index++);
+                Separate(Buffer, Format, Frame.Index != 1, Level);
+                Buffer.Put('\"');
+                sJSONWriteEscaped(Buffer, Member.first);
+                Buffer.Write("\":", 2);
+                Member.second->Edit.Parent = Frame.Container->GetEditState();
+                Value = Member.second->Value;
+            } else {
+                auto &ValueSet = static_cast<sJSONArray *>(Frame.Container)->ValueSet;
+                if (Frame.Index == ValueSet.size()) {
+                    CloseCached(Cache, Stack, Format, ValueSet.empty(), ']');
+                    continue;
+                }
+
+                Separate(Buffer, Format, Frame.Index != 0, Level);
+                Value = ValueSet[Frame.Index++];
+            }
+
+            // Linking every container written to its parent is what lets a later edit reach the
+            // containers above it.
+            if (auto State = Value->GetEditState()) {
+                State->Parent = Frame.Container->GetEditState();
+            }
+            OpenCached(Value, Cache, Stack);
+        }
+
+        std::swap(Cache.Text, Buffer.GetString());
+    }
+
+    static void OpenCached(sJSONValue *Node, sJSONWriteCache &Cache, std::vector<sJSONCachedFrame> &Stack) {
+        auto &Buffer = Cache.Scratch;
+        auto State = Node->GetEditState();
+        if (State == nullptr) {
+            WriteScalar(Node, Buffer);
+            return;
+        }
+        if (State->Revision == 0) {
+            State->Revision = sJSONEditState::NextRevision();
+        }
+
+        // The outermost container sits at the start of the last text, as long as there is one.
+        const sJSONValue *Parent = nullptr;
+        size_t ParentStart = 0;
+        size_t ParentOldStart = Cache.Text.empty() ? std::string::npos : 0;
+        uint64_t ParentOldRevision = 0;
+        if (!Stack.empty()) {
+            Parent = Stack.back().Container;
+            ParentStart = Stack.back().Start;
+            ParentOldStart = Stack.back().OldStart;
+            ParentOldRevision = Stack.back().OldRevision;
+        }
+
+        size_t Start = Buffer.GetString().size();
+        size_t OldStart = std::string::npos;
+        uint64_t OldRevision = 0;
+        if (ParentOldStart != std::string::npos) {
+            auto Instance = Cache.Spans.find(Node);
+            if (Instance != Cache.Spans.end() && Instance->second.Parent == Parent &&
+                Instance->second.ParentRevision == ParentOldRevision) {
+                auto &Span = Instance->second;
+                if (Span.Revision == State->Revision) {
+                    Buffer.Write(Cache.Text.data() + ParentOldStart + Span.Offset, Span.Length);
+                    Span.Offset = Start - ParentStart;
+                    Span.ParentRevision = Parent == nullptr ? 0 : Stack.back().Container->GetEditState()->Revision;
+                    return;
+                }
+
+                OldStart = ParentOldStart + Span.Offset;
+                OldRevision = Span.Revision;
+            }
+        }
+
+        Stack.push_back({Node, 0, Start, OldStart, OldRevision});
+        Buffer.Put(Node->GetType() == sJSONValueType::Object ? '{' : '[');
+    }
+
+    static void CloseCached(sJSONWriteCache &Cache, std::vector<sJSONCachedFrame> &Stack, bool Format, bool Empty,
+                            char Closer) {
+        auto Frame = Stack.back();
+        Stack.pop_back();
+        CloseStruct(Cache.Scratch, Format, Empty, Stack.size(), Closer);
+
+        // Every child of a container written again gets its span renewed or dropped here, so a span
+        // left with the old revision of its parent belongs to a child that was removed.
+        size_t Length = Cache.Scratch.GetString().size() - Frame.Start;
+        if (Length < Cache.MinBytes) {
+            Cache.Spans.erase(Frame.Container);
+            return;
+        }
+
+        auto &Span = Cache.Spans[Frame.Container];
+        Span.Revision = Frame.Container->GetEditState()->Revision;
+        Span.Length = Length;
+        if (Stack.empty()) {
+            Span.Parent = nullptr;
+            Span.ParentRevision = 0;
+            Span.Offset = Frame.Start;
+        } else {
+            Span.Parent = Stack.back().Container;
+            Span.ParentRevision = Stack.back().Container->GetEditState()->Revision;
+            Span.Offset = Frame.Start - Stack.back().Start;
+        }
+    }
+
+    // Fills the slot at Slot. Strings and keys are appended to the end of Output; the element slots
+    // and member table of a container are reserved there and filled when Pending reaches them.
+    static void WriteSnapshotValue(sJSONValue *Node, size_t Slot, std::string &Output,
+                                   std::unordered_map<std::string_view, uint32_t> &KeyOffsets,
+                                   std::vector<std::pair<size_t, sJSONValue *>> &Pending) {
+        auto Reserve = [&](size_t Size) {
+            size_t Offset = Output.size();
+            Output.resize(Offset + Size);
+            return Offset;
+        };
+        auto Append = [&](std::string_view Text) {
+            size_t Offset = Output.size();
+            Output.append(Text.data(), Text.size());
+            Output.resize((Output.size() + 3) & ~size_t(3));
+            return static_cast<uint32_t>(Offset);
+        };
+        auto Fill = [&](sJSONBinaryTag Tag, size_t Offset, uint64_t Payload) {
+            sJSONStore32(Output.data() + Slot, static_cast<uint32_t>(Tag));
+            sJSONStore32(Output.data() + Slot + 4, static_cast<uint32_t>(Offset));
+            sJSONStore64(Output.data() + Slot + 8, Payload);
+        };
+
+        switch (Node->GetType()) {
+            case sJSONValueType::Object: {
+                auto &Children = static_cast<sJSONObject *>(Node)->Children;
+                size_t Count = Children.Size();
+                size_t Capacity = 0;
+                if (Count > sJSONMemberTable::IndexThreshold) {
+                    for (Capacity = 16; Capacity < Count * 2; Capacity *= 2) {
+                    }
+                }
+
+                size_t Block = Reserve(4 + Count * sJSONSnapshotLayout::MemberSize + Capacity * 4);
+                size_t Members = Block + 4;
+                size_t Table = Members + Count * sJSONSnapshotLayout::MemberSize;
+                Fill(sJSONBinaryTag::Object, Block, Count);
+                sJSONStore32(Output.data() + Block, static_cast<uint32_t>(Capacity));
+                for (size_t Position = 0; Position < Count; ++Position) {
+                    auto &Member = Children.At(Position);
+                    auto Key = KeyOffsets.find(Member.first);
+                    if (Key == KeyOffsets.end()) {
+                        Key = KeyOffsets.emplace(Member.first, Append(Member.first)).first;
+                    }
+
+                    size_t Entry = Members + Position * sJSONSnapshotLayout::MemberSize;
+                    sJSONStore32(Output.data() + Entry, Key->second);
+                    sJSONStore32(Output.data() + Entry + 4, static_cast<uint32_t>(Member.first.size()));
+                    if (Capacity != 0) {
+                        size_t Index = static_cast<size_t>(sJSONHashKey(Member.first)) & (Capacity - 1);
+                        while (sJSONLoad32(Output.data() + Table + Index * 4) != 0) {
+                            Index = (Index + 1) & (Capacity - 1);
+                        }
+                        sJSONStore32(Output.data() + Table + Index * 4, static_cast<uint32_t>(Position + 1));
+                    }
+                }
+                for (size_t Position = Count; Position-- > 0;) {
+                    Pending.emplace_back(Members + Position * sJSONSnapshotLayout::MemberSize + 8,
+                                         Children.At(Position).second->Value);
+                }
+                return;
+            }
+            case sJSONValueType::Array: {
+                auto &ValueSet = static_cast<sJSONArray *>(Node)->ValueSet;
+                size_t Elements = Reserve(ValueSet.size() * sJSONSnapshotLayout::SlotSize);
+                Fill(sJSONBinaryTag::Array, Elements, ValueSet.size());
+                for (size_t Index = ValueSet.size(); Index-- > 0;) {
+                    Pending.emplace_back(Elements + Index * sJSONSnapshotLayout::SlotSize, ValueSet[Index]);
+                }
+                return;
+            }
+            case sJSONValueType::Null: {
+                Fill(sJSONBinaryTag::Null, 0, 0);
+                return;
+            }
+            default: {
+                break;
+            }
+        }
+
+        if (sJSONRealValue<std::string_view>::Equal(Node)) {
+            auto &Value = static_cast<sJSONRealValue<std::string_view> *>(Node)->Value;
+            Fill(sJSONBinaryTag::String, Append(Value), Value.size());
+        } else if (sJSONRealValue<std::string>::Equal(Node)) {
+            auto &Value = static_cast<sJSONRealValue<std::string> *>(Node)->Value;
+            Fill(sJSONBinaryTag::String, Append(Value), Value.size());
+        } else if (sJSONRealValue<int>::Equal(Node)) {
+            Fill(sJSONBinaryTag::Int, 0, static_cast<int64_t>(static_cast<sJSONInt *>(Node)->Value));
+        } else if (sJSONRealValue<int64_t>::Equal(Node)) {
+            Fill(sJSONBinaryTag::Int64, 0, static_cast<sJSONInt64 *>(Node)->Value);
+        } else if (sJSONRealValue<uint64_t>::Equal(Node)) {
+            Fill(sJSONBinaryTag::UInt64, 0, static_cast<sJSONUInt64 *>(Node)->Value);
+        } else if (sJSONRealValue<double>::Equal(Node)) {
+            uint64_t Bits;
+            double Value = static_cast<sJSONDouble *>(Node)->Value;
+            memcpy(&Bits, &Value, sizeof(Bits));
+            Fill(sJSONBinaryTag::Double, 0, Bits);
+        } else if (sJSONRealValue<bool>::Equal(Node)) {
+            Fill(static_cast<sJSONBoolean *>(Node)->Value ? sJSONBinaryTag::True : sJSONBinaryTag::False, 0, 0);
+        } else {
+            Fill(sJSONBinaryTag::Null, 0, 0);
+        }
+    }
+
+    template<class Sink>
+    static void WriteBinaryValue(sJSONValue *Node, Sink &Output, std::vector<sJSONWriterFrame> &Stack) {
+        char Buffer[16];
+        auto Tag = [&](sJSONBinaryTag Value) { Output.Put(static_cast<char>(Value)); };
+        auto Varint = [&](uint64_t Value) { Output.Write(Buffer, sJSONEncodeVarint(Buffer, Value) - Buffer); };
+        switch (Node->GetType()) {
+            case sJSONValueType::Object: {
+                Tag(sJSONBinaryTag::Object);
+                Varint(static_cast<sJSONObject *>(Node)->Children.Size());
+                Stack.push_back({Node, 0});
+                return;
+            }
+            case sJSONValueType::Array: {
+                Tag(sJSONBinaryTag::Array);
+                Varint(static_cast<sJSONArray *>(Node)->ValueSet.size());
+                Stack.push_back({Node, 0});
+                return;
+            }
+            case sJSONValueType::Null: {
+                Tag(sJSONBinaryTag::Null);
+                return;
+            }
+            default: {
+                break;
+            }
+        }
+
+        std::string_view String;
+        if (sJSONRealValue<std::string_view>::Equal(Node)) {
+            String = static_cast<sJSONRealValue<std::string_view> *>(Node)->Value;
+        } else if (sJSONRealValue<std::string>::Equal(Node)) {
+            String = static_cast<sJSONRealValue<std::string> *>(Node)->Value;
+        } else if (sJSONRealValue<int>::Equal(Node)) {
+            Tag(sJSONBinaryTag::Int);
+            Varint(sJSONZigZag(static_cast<sJSONInt *>(Node)->Value));
+            return;
+        } else if (sJSONRealValue<int64_t>::Equal(Node)) {
+            Tag(sJSONBinaryTag::Int64);
+            Varint(sJSONZigZag(static_cast<sJSONInt64 *>(Node)->Value));
+            return;
+        } else if (sJSONRealValue<uint64_t>::Equal(Node)) {
+            Tag(sJSONBinaryTag::UInt64);
+            Varint(static_cast<sJSONUInt64 *>(Node)->Value);
+            return;
+        } else if (sJSONRealValue<double>::Equal(Node)) {
+            uint64_t Bits;
+            double Value = static_cast<sJSONDouble *>(Node)->Value;
+            memcpy(&Bits, &Value, sizeof(Bits));
+            for (int Byte = 0; Byte < 8; ++Byte) {
+                Buffer[Byte] = static_cast<char>(Bits >> (Byte * 8));
+            }
+            Tag(sJSONBinaryTag::Double);
+            Output.Write(Buffer, 8);
+            return;
+        } else if (sJSONRealValue<bool>::Equal(Node)) {
+            Tag(static_cast<sJSONBoolean *>(Node)->Value ? sJSONBinaryTag::True : sJSONBinaryTag::False);
+            return;
+        } else {
+            Tag(sJSONBinaryTag::Null);
+            return;
+        }
+
+        Tag(sJSONBinaryTag::String);
+        Varint(String.size());
+        Output.Write(String.data(), String.size());
+    }
+
+    template<class Sink>
+    static void WriteScalar(sJSONValue *Node, Sink &Output) {
+        if (Node->GetType() == sJSONValueType::Null) {
+            Output.Write("null", 4);
+            return;
+        }
+        if (sJSONRealValue<std::string_view>::Equal(Node)) {
+            auto &Value = static_cast<sJSONRealValue<std::string_view> *>(Node)->Value;
+            Output.Put('\"');
+            sJSONWriteEscaped(Output, Value);
+            Output.Put('\"');
+            return;
+        }
+        if (sJSONRealValue<std::string>::Equal(Node)) {
+            auto &Value = static_cast<sJSONRealValue<std::string> *>(Node)->Value;
+            Output.Put('\"');
+            sJSONWriteEscaped(Output, Value);
+            Output.Put('\"');
+            return;
+        }
+        char Buffer[32];
+        if (sJSONRealValue<int>::Equal(Node)) {
+            Output.Write(Buffer, sJSONFormatNumber(Buffer, static_cast<sJSONInt *>(Node)->Value) - Buffer);
+            return;
+        }
+        if (sJSONRealValue<double>::Equal(Node)) {
+            Output.Write(Buffer, sJSONFormatNumber(Buffer, static_cast<sJSONDouble *>(Node)->Value) - Buffer);
+            return;
+        }
+        if (sJSONRealValue<int64_t>::Equal(Node)) {
+            Output.Write(Buffer, sJSONFormatNumber(Buffer, static_cast<sJSONInt64 *>(Node)->Value) - Buffer);
+            return;
+        }
+        if (sJSONRealValue<uint64_t>::Equal(Node)) {
+            Output.Write(Buffer, sJSONFormatNumber(Buffer, static_cast<sJSONUInt64 *>(Node)->Value) - Buffer);
+            return;
+        }
+        if (sJSONRealValue<bool>::Equal(Node)) {
+            if (static_cast<sJSONBoolean *>(Node)->Value) {
+                Output.Write("true", 4);
+            } else {
+                Output.Write("false", 5);
+            }
+            return;
+        }
+
+        Output.Put('?');
+    }
 };
 
-class sJSONLexer {
+// Rewrites JSON text compact or indented like sJSONWriter::WriteJSON without building a tree: tokens are
+// copied as they are, in their original order, and only the whitespace between them changes. Input is
+// classified 64 bytes at a time by the structural indexer, so runs of whitespace are skipped a block at
+// a time, and it may arrive in pieces of any size. Memory grows with the nesting depth and the longest
+// token, not with the document. What has been written stays written when an error turns up later.
+template<class Sink>
+class sJSONTranscoder {
 public:
-    sJSONLexer(const std::string &Code) : sJSON(Code) {
-        Line = 1;
-        Iterator = sJSON.begin();
-        Rawstring = true;
+    static constexpr size_t ReadSize = 64 * 1024;
+
+public:
+    sJSONTranscoder(Sink &Output, bool Format = true, sJSONSIMDLevel Level = sJSONActiveSIMDLevel)
+            : Output(&Output), Indexer(std::string_view(), Level), Format(Format) {
+        Reset();
     }
 
+    sJSONTranscoder(const sJSONTranscoder &) = delete;
+
+    sJSONTranscoder &operator=(const sJSONTranscoder &) = delete;
+
 public:
-    inline std::tuple<std::string, sJSONTokenType> operator()() {
-        if (Iterator == sJSON.end() || *Iterator == '\0') {
-            return {"", sJSONTokenType::End};
+    // Rewrites the next piece of the document. Complete means a whole document has been read; only
+    // whitespace may follow it.
+    sJSONPushStatus Feed(std::string_view Chunk) {
+        if (State == sJSONPushStatus::Error) {
+            return State;
         }
-        std::string Token;
-        bool ExsitsDot = false;
-        bool Number = false;
-        while (Iterator != sJSON.end()) {
-            if (*Iterator == '\n' || *Iterator == '\r') {
-                ++Line;
-            } else if (*Iterator >= 'a' && *Iterator <= 'z' && *Iterator >= 'A' && *Iterator <= 'Z' &&
-                       *Iterator == '_' &&
-                       !Number) {
-                Token.push_back(*Iterator);
-            } else if (((*Iterator >= '0' && *Iterator <= '9') || *Iterator == '.') && (Token.empty() || Number)) {
-                Number = true;
-                if (*Iterator == '.') {
-                    if (ExsitsDot) {
-                        ExsitsDot = true;
-                        Token.push_back(*Iterator);
-                    } else {
-                        ParserStatus->ErrorInfo.push_back("<Bad number>");
-                        return {"", sJSONTokenType::Unknown};
-                    }
-                } else {
-                    Token.push_back(*Iterator);
-                }
-            } else if (!Token.empty()) {
-                if (!Number) {
-                    if (Token == "true" || Token == "false") {
-                        return {Token, sJSONTokenType::Boolean};
-                    }
-                    if (Token == "nul") {
-                        return {Token, sJSONTokenType::Null};
-                    } else {
-                        return {Token, sJSONTokenType::Unknown};
-                    }
-                } else {
-                    if (!ExsitsDot) {
-                        return {Token, sJSONTokenType::Number};
-                    } else {
-                        return {Token, sJSONTokenType::Float};
-                    }
-                }
-            } else if (*Iterator == '\"') {
-                if (!Rawstring) {
-                    Token.push_back(*Iterator);
-                }
-                ++Iterator;
-                while (Iterator != sJSON.end()) {
-                    if (*Iterator == '\"') {
-                        if (!Rawstring) {
-                            Token.push_back(*Iterator);
-                        }
-                        ++Iterator;
-                        return {Token, sJSONTokenType::string};
-                    }
-                    if (*Iterator == '\\') {
-                        if (Iterator + 1 != sJSON.end() && Rawstring) {
-                            ++Iterator;
-                            if (*Iterator == '\"') {
-                                Token.push_back('\"');
-                            }
-                            if (*Iterator == 't') {
-                                Token.push_back('\t');
-                            }
-                            if (*Iterator == 'n') {
-                                Token.push_back('\n');
-                            }
-                            if (*Iterator == 'r') {
-                                Token.push_back('\r');
-                            }
-                        } else {
-                            ParserStatus->ErrorInfo.push_back("Not match \" of the begin of \"");
-                            return {"", sJSONTokenType::Unknown};
-                        }
-                    } else {
-                        Token.push_back(*Iterator);
-                    }
 
-                    ++Iterator;
-                }
-            } else if (*Iterator != L' ' && *Iterator != L'\t') {
-                sJSONTokenType Type = sJSONTokenType::Unknown;
-                if (sJSONTokenMap.find(*Iterator) != sJSONTokenMap.end()) {
-                    Type = sJSONTokenMap[*Iterator];
-                }
+        // Bytes are only kept from the token still open and the partial block at the end.
+        if (Window.empty()) {
+            size_t Keep = Process(Chunk.data(), Chunk.size(), false);
+            Window.assign(Chunk.data() + Keep, Chunk.size() - Keep);
+        } else {
+            Window.append(Chunk.data(), Chunk.size());
+            Window.erase(0, Process(Window.data(), Window.size(), false));
+        }
 
-                Token.push_back(*Iterator);
-                ++Iterator;
+        return UpdateState();
+    }
 
-                return {Token, Type};
-            }
+    // Marks the end of the input and writes the token it ends. A document that is still open is an error.
+    sJSONPushStatus Finish() {
+        if (State == sJSONPushStatus::Error) {
+            return State;
+        }
 
-            ++Iterator;
+        Process(Window.data(), Window.size(), true);
+        Window.clear();
+        if (State == sJSONPushStatus::Error) {
+            return State;
         }
 
-        return {"", sJSONTokenType::End};
-    }
+        if (Indexer.InString()) {
+            Status.ErrorInfo.push_back("Not match \" of the begin of \"");
+            State = sJSONPushStatus::Error;
+            return State;
+        }
+        if (Expect != Expecting::Done) {
+            Status.ErrorInfo.push_back("<Bad sJSON tree>");
+            State = sJSONPushStatus::Error;
+        }
 
-    bool operator*() {
-        return Iterator != sJSON.end();
+        return UpdateState();
     }
 
-    const size_t GetLine() const {
-        return Line;
-    }
+    bool Transcode(std::string_view Code) {
+        Reset();
+        Feed(Code);
 
-public:
-    bool Rawstring;
+        return Finish() == sJSONPushStatus::Complete;
+    }
 
-private:
-    sJSONParserStatus *ParserStatus;
-    std::string::iterator Iterator;
-    std::string sJSON;
-    size_t Line;
-};
+    bool Transcode(FILE *File) {
+        Reset();
+        std::vector<char> Buffer(ReadSize);
+        size_t Size;
+        while (State != sJSONPushStatus::Error && (Size = fread(Buffer.data(), 1, Buffer.size(), File)) != 0) {
+            Feed(std::string_view(Buffer.data(), Size));
+        }
 
-class sJSONParser {
-public:
-    sJSONParser(std::string Code) : RootObject(new sJSONObject()), Lexer(Code) {
+        return Finish() == sJSONPushStatus::Complete;
     }
 
-public:
-    sJSONRootNode Parse() {
-        auto Token = Lexer();
-        switch (std::get<1>(Token)) {
-            case sJSONTokenType::BigLeft: {
-                sJSONParser *SubParser = new sJSONParser(
-                        FetchContext(sJSONTokenType::BigLeft, sJSONTokenType::BigRight));
-                RootObject->Children = SubParser->ParseSet();
-                if (SubParser->Status.ExsitsError()) {
-                    Status = SubParser->Status;
-                    return sJSONRootNode(RootObject);
-                }
+    // Starts over on a new document, keeping the buffers.
+    void Reset() {
+        Indexer.Reset(std::string_view());
+        Status.ErrorInfo.clear();
+        Stack.clear();
+        Window.clear();
+        Expect = Expecting::Value;
+        State = sJSONPushStatus::NeedMoreData;
+        Scanned = 0;
+        Token = NoToken;
+        Line = 1;
+    }
 
-                break;
-            }
-            default: {
-                Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                return sJSONRootNode(RootObject);
-            }
-        }
+    const sJSONPushStatus GetState() const {
+        return State;
+    }
 
-        return sJSONRootNode(RootObject);
+    const sJSONParserStatus &GetStatus() const {
+        return Status;
     }
 
 private:
-    std::map<std::string, sJSONElementNode *> ParseSet() {
-        std::map<std::string, sJSONElementNode *> Set;
-        while (*Lexer) {
-            auto Token = Lexer();
-            switch (std::get<1>(Token)) {
-                case sJSONTokenType::string: {
-                    std::string Tag = std::get<0>(Token);
-                    Token = Lexer();
+    enum class Expecting {
+        Value,
+        ValueOrClose,
+        Key,
+        KeyOrClose,
+        Colon,
+        CommaOrClose,
+        Done
+    };
+
+    static constexpr size_t NoToken = std::string_view::npos;
 
-                    if (std::get<1>(Token) != sJSONTokenType::Colon) {
-                        Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                        return std::map<std::string, sJSONElementNode *>();
-                    }
+private:
+    // Indexes the whole blocks of Data from Scanned on, and the partial one at the end when Last is set,
+    // writing every token they complete. Returns how many leading bytes are no longer needed; Scanned
+    // and Token are moved back by as much.
+    size_t Process(const char *Data, size_t Size, bool Last) {
+        for (; State != sJSONPushStatus::Error && Scanned + 64 <= Size; Scanned += 64) {
+            ProcessBlock(Data, Data + Scanned);
+        }
+        if (Last) {
+            if (State != sJSONPushStatus::Error && Scanned < Size) {
+                char Padding[64];
+                memset(Padding, ' ', sizeof(Padding));
+                memcpy(Padding, Data + Scanned, Size - Scanned);
+                ProcessBlock(Data, Padding);
+                Scanned = Size;
+            }
+            if (State != sJSONPushStatus::Error && Token != NoToken) {
+                CompleteToken(Data, Size);
+            }
 
-                    auto Value = ParseValue();
-                    if (Status.ExsitsError()) {
-                        return std::map<std::string, sJSONElementNode *>();
-                    }
+            return Size;
+        }
 
-                    Set.emplace(Tag, new sJSONElementNode(Tag, Value));
-                    if (Value->GetType() == sJSONValueType::Object) {
-                        Set[Tag]->Children = static_cast<sJSONObject *>(Value)->Children;
-                    }
+        size_t Keep = Token < Scanned ? Token : Scanned;
+        Scanned -= Keep;
+        if (Token != NoToken) {
+            Token -= Keep;
+        }
 
-                    Token = Lexer();
-                    if (std::get<1>(Token) != sJSONTokenType::Comma && std::get<1>(Token) != sJSONTokenType::End) {
-                        Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                        return std::map<std::string, sJSONElementNode *>();
-                    }
+        return Keep;
+    }
+
+    void ProcessBlock(const char *Data, const char *Block) {
+        Positions.clear();
+        int Newlines = Indexer.IndexBlock(Block, Scanned, Positions);
+        for (auto Position : Positions) {
+            if (Token != NoToken && !CompleteToken(Data, Position)) {
+                return;
+            }
 
+            switch (Data[Position]) {
+                case '{':
+                case '[': {
+                    Open(Data[Position] == '{', Data, Position);
+                    break;
+                }
+                case '}':
+                case ']': {
+                    Close(Data[Position] == '}', Data, Position);
+                    break;
+                }
+                case ',': {
+                    Comma(Data, Position);
+                    break;
+                }
+                case ':': {
+                    Colon(Data, Position);
                     break;
                 }
                 default: {
-                    Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                    return std::map<std::string, sJSONElementNode *>();
+                    Token = Position;
+                    break;
                 }
             }
+            if (State == sJSONPushStatus::Error) {
+                return;
+            }
         }
 
-        return Set;
+        Line += Newlines;
     }
 
-    sJSONArray *ParseArray() {
-        sJSONArray *Array = new sJSONArray;
-        while (*Lexer) {
-            Array->ValueSet.push_back(ParseValue());
-            if (Status.ExsitsError()) {
-                return nullptr;
-            }
-            auto Token = Lexer();
+    // Writes the string or scalar that started at Token and ended before End.
+    bool CompleteToken(const char *Data, size_t End) {
+        std::string_view Text(Data + Token, End - Token);
+        Token = NoToken;
+        while (Text.back() == ' ' || Text.back() == '\t' || Text.back() == '\n' || Text.back() == '\r') {
+            Text.remove_suffix(1);
+        }
+        if (Text.front() == '\"' && !CheckEscapes(Text)) {
+            return false;
+        }
 
-            if (std::get<1>(Token) != sJSONTokenType::End && std::get<1>(Token) != sJSONTokenType::Comma) {
-                Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                return nullptr;
-            }
+        if (Text.front() == '\"' && (Expect == Expecting::Key || Expect == Expecting::KeyOrClose)) {
+            NewLine(Expect == Expecting::KeyOrClose, Stack.size());
+            Output->Write(Text.data(), Text.size());
+            Expect = Expecting::Colon;
+            return true;
+        }
+
+        bool IsNumber = Text.front() != '\"' && Text != "true" && Text != "false" && Text != "null";
+        if (IsNumber && !sJSONIsDigit(Text.front()) && Text.front() != '-') {
+            UnknownToken(Data, End);
+            return false;
         }
+        if (!BeginValue(Data, End)) {
+            return false;
+        }
+
+        sJSONNumber Number;
+        if (IsNumber && !sJSONParseNumber(Text, Number)) {
+            Status.ErrorInfo.push_back("<Bad number>");
+            State = sJSONPushStatus::Error;
+            return false;
+        }
+        Output->Write(Text.data(), Text.size());
 
-        return Array;
+        return true;
     }
 
-    sJSONValue *ParseValue() {
-        while (*Lexer) {
-            auto Token = Lexer();
-            switch (std::get<1>(Token)) {
-                case sJSONTokenType::string: {
-                    return new sJSONRealValue<std::string>(std::get<0>(Token));
-                }
-                case sJSONTokenType::Number: {
-                    return new sJSONRealValue<int>(atoi(std::get<0>(Token).c_str()));
-                }
-                case sJSONTokenType::Float: {
-                    return new sJSONRealValue<double>(atoi(std::get<0>(Token).c_str()));
-                }
-                case sJSONTokenType::Null: {
-                    return new sJSONNull();
-                }
-                case sJSONTokenType::Boolean: {
-                    if (std::get<0>(Token) == "true") {
-                        return new sJSONRealValue<bool>(true);
-                    } else {
-                        return new sJSONRealValue<bool>(false);
-                    }
-                }
-                case sJSONTokenType::BigLeft: {
-                    sJSONParser *SubParser =
-                            new sJSONParser(FetchContext(std::get<1>(Token), sJSONOppsiteTokenMap[std::get<1>(Token)]));
-                    auto Value = new sJSONObject(SubParser->ParseSet());
+    // Strings are copied as they are, so their escapes are only decoded to see that they are valid.
+    bool CheckEscapes(std::string_view Text) {
+        auto Raw = Text.substr(1, Text.size() >= 2 ? Text.size() - 2 : 0);
+        if (Raw.find('\\') == std::string_view::npos) {
+            return true;
+        }
 
-                    delete SubParser;
+        Scratch.resize(Raw.size());
+        if (sJSONDecodeString(Raw, Scratch.data()) == sJSONBadString) {
+            Status.ErrorInfo.push_back("<Bad string>");
+            State = sJSONPushStatus::Error;
+            return false;
+        }
 
-                    return Value;
-                }
-                case sJSONTokenType::MiddleLeft: {
-                    sJSONParser *SubParser =
-                            new sJSONParser(FetchContext(std::get<1>(Token), sJSONOppsiteTokenMap[std::get<1>(Token)]));
-                    auto Array = SubParser->ParseArray();
+        return true;
+    }
+
+    bool BeginValue(const char *Data, size_t Position) {
+        if (Expect != Expecting::Value && Expect != Expecting::ValueOrClose) {
+            UnknownToken(Data, Position);
+            return false;
+        }
 
-                    delete SubParser;
+        NewLine(Expect == Expecting::ValueOrClose, Stack.size());
+        Expect = Stack.empty() ? Expecting::Done : Expecting::CommaOrClose;
+        return true;
+    }
 
-                    return Array;
-                }
-                default: {
-                    Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lexer.GetLine()) + ".");
-                    return nullptr;
-                }
-            }
+    void Open(bool IsObject, const char *Data, size_t Position) {
+        if (!BeginValue(Data, Position)) {
+            return;
         }
 
-        Status.ErrorInfo.push_back("<Bad sJSON>");
-        return nullptr;
+        Output->Put(IsObject ? '{' : '[');
+        Stack.push_back(IsObject ? 1 : 0);
+        Expect = IsObject ? Expecting::KeyOrClose : Expecting::ValueOrClose;
     }
 
-private:
-    inline std::string FetchContext(const sJSONTokenType &Left, const sJSONTokenType &Right) {
-        Lexer.Rawstring = false;
-        std::string Context;
-        int DeepthLevel = 0;
-        while (*Lexer) {
-            auto Tuple = Lexer();
-            if (std::get<1>(Tuple) == Left) {
-                ++DeepthLevel;
-            }
-            if (std::get<1>(Tuple) == Right) {
-                --DeepthLevel;
-                if (DeepthLevel == -1) {
-                    Lexer.Rawstring = true;
-                    return Context;
-                }
-            }
+    void Close(bool IsObject, const char *Data, size_t Position) {
+        auto Opened = IsObject ? Expecting::KeyOrClose : Expecting::ValueOrClose;
+        if (Stack.empty() || (Stack.back() != 0) != IsObject ||
+            (Expect != Expecting::CommaOrClose && Expect != Opened)) {
+            UnknownToken(Data, Position);
+            return;
+        }
+
+        Stack.pop_back();
+        NewLine(Expect != Opened, Stack.size());
+        Output->Put(IsObject ? '}' : ']');
+        Expect = Stack.empty() ? Expecting::Done : Expecting::CommaOrClose;
+    }
+
+    void Comma(const char *Data, size_t Position) {
+        if (Expect != Expecting::CommaOrClose) {
+            UnknownToken(Data, Position);
+            return;
+        }
 
-            Context.append(std::get<0>(Tuple) + " ");
+        Output->Put(',');
+        NewLine(true, Stack.size());
+        Expect = Stack.back() != 0 ? Expecting::Key : Expecting::Value;
+    }
+
+    void Colon(const char *Data, size_t Position) {
+        if (Expect != Expecting::Colon) {
+            UnknownToken(Data, Position);
+            return;
+        }
+
+        Output->Put(':');
+        Expect = Expecting::Value;
+    }
+
+    __forceinline void NewLine(bool Needed, size_t Level) {
+        if (Format && Needed) {
+            Output->Put('\n');
+            sJSONWriter::Indent(*Output, Level);
         }
+    }
+
+    // Line holds the lines before the block being processed, which starts at Scanned.
+    void UnknownToken(const char *Data, size_t Position) {
+        size_t Lines = Line + std::count(Data + Scanned, Data + Position, '\n');
+        Status.ErrorInfo.push_back("Unknown token at line " + std::to_string(Lines) + ".");
+        State = sJSONPushStatus::Error;
+    }
 
-        Status.ErrorInfo.push_back("<Bad sJSON tree>");
+    sJSONPushStatus UpdateState() {
+        if (State != sJSONPushStatus::Error) {
+            bool Complete = Expect == Expecting::Done && Token == NoToken;
+            State = Complete ? sJSONPushStatus::Complete : sJSONPushStatus::NeedMoreData;
+        }
 
-        return Context;
+        return State;
     }
 
 private:
-    sJSONLexer Lexer;
-    sJSONObject *RootObject;
+    Sink *Output;
+    sJSONStructuralIndexer Indexer;
     sJSONParserStatus Status;
+    std::vector<size_t> Positions;
+    std::vector<char> Stack;
+    std::string Window;
+    std::string Scratch;
+    Expecting Expect;
+    sJSONPushStatus State;
+    size_t Scanned;
+    size_t Token;
+    size_t Line;
+    bool Format;
 };
 
-#define sJSONHelperCountDown(Var) for (int Count = 0; Count < Var; ++Count)
+// Immutable copy of a tree, made by sJSONDocument::Freeze: the values laid out as a snapshot (see
+// sJSONSnapshotLayout) in memory the document owns. Nothing in it changes once it is built, and
+// sJSONSnapshotValue and sJSONSnapshotIterator are plain handles into those bytes, so any number of
+// threads can look values up and iterate over them at the same time without locking. Values stay
+// valid for as long as the document, moves included.
+class sJSONFrozenDocument {
+public:
+    explicit sJSONFrozenDocument(sJSONRootNode &Root) : Data(sJSONWriter::WriteSnapshot(Root)) {
+    }
+
+    sJSONFrozenDocument(const sJSONFrozenDocument &) = delete;
+
+    sJSONFrozenDocument &operator=(const sJSONFrozenDocument &) = delete;
+
+    sJSONFrozenDocument(sJSONFrozenDocument &&) = default;
+
+    sJSONFrozenDocument &operator=(sJSONFrozenDocument &&) = default;
 
-class sJSONWriter {
 public:
-    static std::string WriteJSON(sJSONRootNode &Root, bool Format = true, bool Brackets = true, size_t Level = 1) {
-        std::string sJSON;
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
-            sJSON = "{";
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
-        for (auto &Node: Root) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
+    // False only for a tree too large for a snapshot.
+    const bool IsValid() const {
+        return sJSONSnapshotView(Data).IsValid();
+    }
 
-            sJSON.append("\"" + Node.first + "\"");
-            sJSON.append(":");
-            sJSON.append(WriteValue(Node.second->Value, Format, Brackets, Level));
+    sJSONSnapshotValue GetRoot() const {
+        return sJSONSnapshotView(Data).GetRoot();
+    }
 
-            sJSON.push_back(',');
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
+    sJSONSnapshotValue operator[](std::string_view Key) const {
+        return GetRoot()[Key];
+    }
 
-        sJSON.pop_back();
-        if (Format) {
-            sJSON.pop_back();
-            sJSON.push_back('\n');
-        }
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level - 1) {
-                    sJSON.push_back('\t');
-                }
-            sJSON.push_back('}');
-        }
+    bool Exsits(std::string_view Key) const {
+        return GetRoot().Exsits(Key);
+    }
 
-        return sJSON;
+    std::string_view GetData() const {
+        return Data;
     }
 
-    static std::string
-    WriteJSON(sJSONElementFinder &Finder, bool Format = true, bool Brackets = true, size_t Level = 1) {
-        std::string sJSON;
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
-            sJSON = "{";
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
-        for (auto &Node: Finder) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
+private:
+    std::string Data;
+};
 
-            sJSON.append(Node.first);
-            sJSON.append(":");
-            sJSON.append(WriteValue(Node.second->Value, Format, Brackets, Level));
+inline sJSONFrozenDocument sJSONDocument::Freeze() {
+    auto Root = GetRoot();
 
-            sJSON.push_back(',');
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
+    return sJSONFrozenDocument(Root);
+}
 
-        sJSON.pop_back();
-        if (Format) {
-            sJSON.pop_back();
-            sJSON.push_back('\n');
-        }
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level - 1) {
-                    sJSON.push_back('\t');
-                }
-            sJSON.push_back('}');
-        }
+struct sJSONFrozenVersion {
+    sJSONFrozenVersion(sJSONFrozenDocument &&Document) : Document(std::move(Document)), References(1) {
+    }
+
+    sJSONFrozenDocument Document;
+    std::atomic<size_t> References;
+};
 
-        return sJSON;
+// A reader's reference to one version published by sJSONFrozenHolder. Copies share the version, which
+// is freed together with its last handle, whichever thread drops it.
+class sJSONFrozenHandle {
+public:
+    sJSONFrozenHandle() : Version(nullptr) {
     }
 
-    static std::string WriteJSONByObject(sJSONObject *Object, bool Format = true, bool Brackets = true,
-                                          size_t Level = 1) {
-        std::string sJSON;
-        if (Brackets) {
-            sJSON = "{";
-            if (Format) {
-                sJSON.push_back('\n');
-            }
+    sJSONFrozenHandle(const sJSONFrozenHandle &Other) : Version(Other.Version) {
+        if (Version != nullptr) {
+            Version->References.fetch_add(1, std::memory_order_relaxed);
         }
-        for (auto &Node: Object->Children) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
+    }
 
-            sJSON.append("\"" + Node.first + "\"");
-            sJSON.append(":");
-            sJSON.append(WriteValue(Node.second->Value, Format, Brackets, Level + 1));
+    sJSONFrozenHandle(sJSONFrozenHandle &&Other) noexcept : Version(Other.Version) {
+        Other.Version = nullptr;
+    }
 
-            sJSON.push_back(',');
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
+    sJSONFrozenHandle &operator=(sJSONFrozenHandle Other) noexcept {
+        std::swap(Version, Other.Version);
 
-        sJSON.pop_back();
-        if (Format) {
-            sJSON.pop_back();
-            sJSON.push_back('\n');
-        }
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level - 1) {
-                    sJSON.push_back('\t');
-                }
-            sJSON.push_back('}');
+        return *this;
+    }
+
+    ~sJSONFrozenHandle() {
+        if (Version != nullptr && Version->References.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete Version;
         }
+    }
 
-        return sJSON;
+public:
+    explicit operator bool() const {
+        return Version != nullptr;
     }
 
-    static std::string
-    WriteJSONByArray(sJSONArray *Object, bool Format = true, bool Brackets = true, size_t Level = 1) {
-        std::string sJSON;
-        if (Brackets) {
-            sJSON = "[";
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
-        for (auto &Node: Object->ValueSet) {
-            if (Format)
-                sJSONHelperCountDown(Level) {
-                    sJSON.push_back('\t');
-                }
+    const sJSONFrozenDocument &operator*() const {
+        return Version->Document;
+    }
 
-            sJSON.append(WriteValue(Node, Format, Brackets, Level));
+    const sJSONFrozenDocument *operator->() const {
+        return &Version->Document;
+    }
 
-            sJSON.push_back(',');
-            if (Format) {
-                sJSON.push_back('\n');
-            }
-        }
+private:
+    friend class sJSONFrozenHolder;
 
-        sJSON.pop_back();
-        if (Format) {
-            sJSON.pop_back();
-            sJSON.push_back('\n');
-        }
-        if (Brackets) {
-            if (Format)
-                sJSONHelperCountDown(Level - 1) {
-                    sJSON.push_back('\t');
-                }
-            sJSON.push_back(']');
-        }
+    // Takes over a reference the caller already counted.
+    explicit sJSONFrozenHandle(sJSONFrozenVersion *Version) : Version(Version) {
+    }
+
+private:
+    sJSONFrozenVersion *Version;
+};
 
-        return sJSON;
+// Hands the current frozen document to reader threads and swaps in new ones for hot reload, in the
+// manner of read-copy-update. Acquire never blocks: it marks itself as reading in one of two counters,
+// loads the current version, counts a reference to it and unmarks. Publish swaps the new version in,
+// then waits until the readers that may have loaded the old pointer before counting their reference
+// have left those few instructions, and returns the holder's reference to the old version. The old
+// version is freed once that and every handle readers still hold are gone.
+class sJSONFrozenHolder {
+public:
+    sJSONFrozenHolder() : Current(nullptr), Epoch(0) {
     }
 
-    static std::string WriteValue(sJSONValue *Node, bool Format = true, bool Brackets = true, size_t Level = 1) {
-        if (Node->GetType() == sJSONValueType::Object) {
-            return WriteJSONByObject(Node->To<sJSONObject *>(), Format, Brackets, Level + 1);
-        }
-        if (Node->GetType() == sJSONValueType::Array) {
-            return WriteJSONByArray(Node->To<sJSONArray *>(), Format, Brackets, Level + 1);
+    explicit sJSONFrozenHolder(sJSONFrozenDocument &&Document) : sJSONFrozenHolder() {
+        Publish(std::move(Document));
+    }
+
+    sJSONFrozenHolder(const sJSONFrozenHolder &) = delete;
+
+    sJSONFrozenHolder &operator=(const sJSONFrozenHolder &) = delete;
+
+    // Readers must be done calling Acquire; the handles they hold stay valid.
+    ~sJSONFrozenHolder() {
+        sJSONFrozenHandle Last(Current.load(std::memory_order_acquire));
+    }
+
+public:
+    // The current version, or an empty handle before the first Publish. Lock-free.
+    sJSONFrozenHandle Acquire() const {
+        auto &Readers = Pins[Epoch.load() & 1].Readers;
+        Readers.fetch_add(1);
+        auto Version = Current.load();
+        if (Version != nullptr) {
+            Version->References.fetch_add(1, std::memory_order_relaxed);
         }
-        if (Node->GetType() == sJSONValueType::Null) {
-            return "nul";
-        } else {
-            if (sJSONRealValue<std::string>::Equal(Node)) {
-                return "\"" + ((sJSONRealValue<std::string> *) Node)->Value + "\"";
-            }
-            if (sJSONRealValue<int>::Equal(Node)) {
-                return std::to_string(((sJSONRealValue<int> *) Node)->Value);
-            }
-            if (sJSONRealValue<double>::Equal(Node)) {
-                return std::to_string(((sJSONRealValue<double> *) Node)->Value);
-            }
-            if (sJSONRealValue<bool>::Equal(Node)) {
-                if (((sJSONRealValue<bool> *) Node)->Value) {
-                    return "true";
-                } else {
-                    return "false";
-                }
+        Readers.fetch_sub(1, std::memory_order_release);
+
+        return sJSONFrozenHandle(Version);
+    }
+
+    // Makes Document the version every later Acquire gets and returns the previous one. Calls to
+    // Publish are serialized; they wait for readers inside Acquire, never for the handles they hold.
+    sJSONFrozenHandle Publish(sJSONFrozenDocument &&Document) {
+        auto Version = new sJSONFrozenVersion(std::move(Document));
+        std::lock_guard<std::mutex> Lock(PublishLock);
+        auto Previous = Current.exchange(Version);
+
+        // A reader that read the epoch before the first flip may still sit in either counter, one that
+        // reads it after a flip can only find the new version. Two flips drain both counters.
+        for (int Flip = 0; Flip < 2; ++Flip) {
+            auto &Readers = Pins[Epoch.fetch_add(1) & 1].Readers;
+            while (Readers.load() != 0) {
+                std::this_thread::yield();
             }
         }
 
-        return "?";
+        return sJSONFrozenHandle(Previous);
+    }
+
+    sJSONFrozenHandle Publish(sJSONRootNode &Root) {
+        return Publish(sJSONFrozenDocument(Root));
     }
-};
\ No newline at end of file
+
+private:
+    // Each counter on its own cache line, away from Current, which readers only load.
+    struct alignas(64) PinCounter {
+        std::atomic<size_t> Readers{0};
+    };
+
+private:
+    std::atomic<sJSONFrozenVersion *> Current;
+    std::atomic<size_t> Epoch;
+    mutable PinCounter Pins[2];
+    std::mutex PublishLock;
+};